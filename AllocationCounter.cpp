@@ -0,0 +1,114 @@
+#include "AllocationCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+static thread_local bool counting = false;
+static thread_local uint64_t allocations = 0;
+
+void AllocationCounter::begin(){
+
+    allocations = 0;
+    counting = true;
+
+}
+
+uint64_t AllocationCounter::end(){
+
+    counting = false;
+    return allocations;
+
+}
+
+// Replacements of the global allocation functions. They allocate with malloc/aligned_alloc like the
+// default ones do, so memory from either side can be released by the other.
+
+static void *allocate(std::size_t size){
+
+    if(counting){
+        allocations++;
+    }
+    return std::malloc(size == 0 ? 1 : size);
+
+}
+
+static void *allocateAligned(std::size_t size, std::align_val_t alignment){
+
+    if(counting){
+        allocations++;
+    }
+    std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    std::size_t rounded = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded == 0 ? align : rounded);
+
+}
+
+void *operator new(std::size_t size){
+
+    void *pointer = allocate(size);
+    if(!pointer){
+        throw std::bad_alloc();
+    }
+    return pointer;
+
+}
+
+void *operator new[](std::size_t size){
+
+    return operator new(size);
+
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept{
+
+    return allocate(size);
+
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept{
+
+    return allocate(size);
+
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment){
+
+    void *pointer = allocateAligned(size, alignment);
+    if(!pointer){
+        throw std::bad_alloc();
+    }
+    return pointer;
+
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment){
+
+    return operator new(size, alignment);
+
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept{
+
+    return allocateAligned(size, alignment);
+
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept{
+
+    return allocateAligned(size, alignment);
+
+}
+
+void operator delete(void *pointer) noexcept{ std::free(pointer); }
+void operator delete[](void *pointer) noexcept{ std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept{ std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept{ std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept{ std::free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept{ std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept{ std::free(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept{ std::free(pointer); }
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept{ std::free(pointer); }
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept{ std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept{ std::free(pointer); }
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept{ std::free(pointer); }
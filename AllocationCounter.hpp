@@ -0,0 +1,21 @@
+#pragma once
+
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+#include <cstdint>
+
+// Counts the heap allocations (global operator new, every overload) made by the calling thread
+// between begin() and end(). The counting operator new is always linked in; outside a
+// begin()/end() pair it costs one thread-local flag test per allocation.
+// Used by --check-allocs to verify that a steady-state frame doesn't touch the heap.
+class AllocationCounter{
+
+    public:
+        static void begin();
+
+        // stops counting and returns the number of allocations since begin()
+        static uint64_t end();
+};
+
+#endif //!_ALLOCATION_COUNTER_HPP
@@ -44,6 +44,9 @@ public:
     glm::vec3 Target = glm::vec3(0.0f);
     float Radius = 0.25f;
 
+    // set whenever the view or the zoom changes, cleared by whoever uploads the camera uniforms
+    bool Dirty = true;
+
     // constructor with vectors
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
@@ -82,6 +85,7 @@ public:
             Position -= Right * velocity;
         if (direction == RIGHT)
             Position += Right * velocity;
+        Dirty = true;
     }
 
     // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
@@ -114,6 +118,7 @@ public:
             Zoom = 1.0f;
         if (Zoom > 45.0f)
             Zoom = 45.0f;
+        Dirty = true;
     }
 
 private:
@@ -133,6 +138,7 @@ private:
         Front = glm::normalize(Target - Position); // Mira al centro
         Right = glm::normalize(glm::cross(Front, WorldUp));
         Up    = glm::normalize(glm::cross(Right, Front));
+        Dirty = true;
     }
 };
 
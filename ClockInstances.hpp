@@ -0,0 +1,127 @@
+#ifndef CLOCK_INSTANCES_HPP
+#define CLOCK_INSTANCES_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GLHandle.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// vertex attribute locations of the per-instance data, above the ones used by every vertex layout
+constexpr unsigned int INSTANCE_TRANSFORM_LOCATION{8};   // mat4, takes locations 8 to 11
+constexpr unsigned int INSTANCE_CLOCK_LOCATION{12};
+
+// which hand, if any, a part of the clock is, the "hand" uniform of the model shader
+enum ClockPart : int {
+    CLOCK_BODY = 0,
+    CLOCK_HOUR_HAND = 1,
+    CLOCK_MINUTE_HAND = 2
+};
+
+// per-instance vertex data of one clock of a wall
+struct ClockInstance {
+    glm::mat4 transform;
+    // x = time zone offset in hours, yzw unused
+    glm::vec4 clock;
+};
+
+// The clocks of a wall, in an instance buffer that is attached to the VAO of every model drawn
+// instanced (see BasicGeometryBuffer::attachInstances). The hands are rotated by the vertex shader
+// from the time of day and each clock's offset, so the buffer is only written when laid out.
+class ClockInstances{
+
+    public:
+        ClockInstances() : capacity(0), clockScale(1.0f), low(0.0f), high(0.0f){}
+
+        ClockInstances(const ClockInstances &) = delete;
+        ClockInstances &operator=(const ClockInstances &) = delete;
+
+        // lays count clocks out on a square grid scaled to the footprint of a single clock, each
+        // one in a different time zone, and uploads them
+        void layoutGrid(size_t count, float clockSize){
+            instances.clear();
+            instances.reserve(count);
+
+            int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+            if(columns < 1){
+                columns = 1;
+            }
+            float scale = 1.0f / columns;
+            int rows = static_cast<int>((count + columns - 1) / columns);
+            float pitch = clockSize * scale;
+            clockScale = scale;
+            low = glm::vec3(-(columns - 1) * 0.5f * pitch, ((columns - 1) * 0.5f - std::max(rows - 1, 0)) * pitch, 0.0f);
+            high = glm::vec3((columns - 1) * 0.5f * pitch, (columns - 1) * 0.5f * pitch, 0.0f);
+            for(size_t i = 0; i < count; i++){
+                int column = static_cast<int>(i % columns);
+                int row = static_cast<int>(i / columns);
+                glm::vec3 offset((column - (columns - 1) * 0.5f) * clockSize * scale, ((columns - 1) * 0.5f - row) * clockSize * scale, 0.0f);
+
+                ClockInstance instance;
+                instance.transform = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(scale));
+                instance.clock = glm::vec4(static_cast<float>(static_cast<int>(i % 24) - 11), 0.0f, 0.0f, 0.0f);
+                instances.push_back(instance);
+            }
+            upload();
+        }
+
+        // binds the instance attributes to the currently bound VAO
+        void bindAttributes(){
+            if(!VBO){
+                VBO.create();
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+
+            for(unsigned int column = 0; column < 4; column++){
+                unsigned int location = INSTANCE_TRANSFORM_LOCATION + column;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(ClockInstance), (void*)(offsetof(ClockInstance, transform) + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location, 1);
+            }
+            glEnableVertexAttribArray(INSTANCE_CLOCK_LOCATION);
+            glVertexAttribPointer(INSTANCE_CLOCK_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(ClockInstance), (void*)offsetof(ClockInstance, clock));
+            glVertexAttribDivisor(INSTANCE_CLOCK_LOCATION, 1);
+        }
+
+        size_t size() const { return instances.size(); }
+
+        // scale applied to the model of every clock
+        float getClockScale() const { return clockScale; }
+
+        // distance from a point to the rectangle the clock centers lie in, never more than to the nearest clock
+        float nearestDistance(const glm::vec3 &point) const{
+            glm::vec3 nearest(std::clamp(point.x, low.x, high.x), std::clamp(point.y, low.y, high.y), 0.0f);
+            return glm::length(point - nearest);
+        }
+
+    private:
+        GLBuffer VBO;
+        size_t capacity;
+        float clockScale;
+        // corners of the rectangle of clock centers, on the z = 0 plane
+        glm::vec3 low;
+        glm::vec3 high;
+        std::vector<ClockInstance> instances;
+
+        void upload(){
+            if(!VBO){
+                VBO.create();
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+            if(instances.size() > capacity){
+                capacity = instances.size();
+                glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(ClockInstance), instances.data(), GL_STATIC_DRAW);
+            } else {
+                glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(ClockInstance), instances.data());
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+};
+
+#endif //!_CLOCK_INSTANCES_HPP
@@ -0,0 +1,164 @@
+#include "FramePacer.hpp"
+
+#include <SDL3/SDL_timer.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_video.h>
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+FramePacer::FramePacer(){
+
+    periodNS = 0;
+    nextDeadline = 0;
+    lastFrame = 0;
+
+    intervalCount = 0;
+    intervalSum = 0.0;
+    intervalSumSquares = 0.0;
+    maxDeviation = 0.0;
+
+}
+
+void FramePacer::setTargetFps(double targetFps){
+
+    periodNS = targetFps > 0.0 ? static_cast<uint64_t>(1000000000.0 / targetFps) : 0;
+    nextDeadline = 0;
+
+}
+
+SwapMode FramePacer::setSwapMode(SwapMode mode){
+
+    switch(mode){
+
+        case SwapMode::AdaptiveVSync:
+            if(SDL_GL_SetSwapInterval(-1) == true){
+                return SwapMode::AdaptiveVSync;
+            }
+            SDL_Log("Adaptive vsync not supported, falling back to vsync: %s\n", SDL_GetError());
+            [[fallthrough]];
+
+        case SwapMode::VSync:
+            SDL_GL_SetSwapInterval(1);
+            return SwapMode::VSync;
+
+        case SwapMode::Uncapped:
+        default:
+            SDL_GL_SetSwapInterval(0);
+            return SwapMode::Uncapped;
+    }
+
+}
+
+double FramePacer::waitForNextFrame(){
+
+    uint64_t now = SDL_GetTicksNS();
+
+    if(periodNS > 0){
+        if(nextDeadline == 0 || now > nextDeadline + periodNS){
+            // first frame, or more than a whole period late: restart the schedule from now
+            nextDeadline = now;
+        } else {
+            sleepUntil(nextDeadline);
+            now = SDL_GetTicksNS();
+        }
+        nextDeadline += periodNS;
+    }
+
+    double delta = 0.0;
+    if(lastFrame != 0){
+        delta = (now - lastFrame) / 1000000000.0;
+        recordInterval(delta * 1000.0);
+    }
+    lastFrame = now;
+
+    return delta;
+}
+
+void FramePacer::resetTiming(){
+
+    lastFrame = 0;
+    nextDeadline = 0;
+
+}
+
+void FramePacer::sleepUntil(uint64_t deadline) const{
+
+    uint64_t now = SDL_GetTicksNS();
+    if(deadline > now + SPIN_THRESHOLD_NS){
+        SDL_DelayNS(deadline - now - SPIN_THRESHOLD_NS);
+    }
+    // spin the last stretch for an accurate wake-up
+    while(SDL_GetTicksNS() < deadline){
+    }
+
+}
+
+void FramePacer::recordInterval(double intervalMs){
+
+    intervalCount++;
+    intervalSum += intervalMs;
+    intervalSumSquares += intervalMs * intervalMs;
+
+    if(periodNS > 0){
+        double deviation = std::fabs(intervalMs - periodNS / 1000000.0);
+        if(deviation > maxDeviation){
+            maxDeviation = deviation;
+        }
+    }
+
+}
+
+double FramePacer::getJitterMs() const{
+
+    if(intervalCount < 2){
+        return 0.0;
+    }
+    double mean = intervalSum / intervalCount;
+    double variance = intervalSumSquares / intervalCount - mean * mean;
+    return variance > 0.0 ? std::sqrt(variance) : 0.0;
+
+}
+
+void FramePacer::report(std::ostream &out) const{
+
+    if(intervalCount == 0){
+        return;
+    }
+
+    out << std::fixed << std::setprecision(3)
+        << "Frame pacing: " << intervalCount << " intervals, mean " << (intervalSum / intervalCount)
+        << " ms, jitter (stddev) " << getJitterMs() << " ms";
+    if(periodNS > 0){
+        out << ", target " << (periodNS / 1000000.0) << " ms, worst deviation " << maxDeviation << " ms";
+    }
+    out << std::endl;
+
+}
+
+bool FramePacer::parseSwapMode(const char *name, SwapMode &mode){
+
+    if(std::strcmp(name, "vsync") == 0){
+        mode = SwapMode::VSync;
+    } else if(std::strcmp(name, "adaptive") == 0){
+        mode = SwapMode::AdaptiveVSync;
+    } else if(std::strcmp(name, "off") == 0 || std::strcmp(name, "uncapped") == 0){
+        mode = SwapMode::Uncapped;
+    } else {
+        return false;
+    }
+    return true;
+
+}
+
+const char *FramePacer::swapModeName(SwapMode mode){
+
+    switch(mode){
+        case SwapMode::VSync: return "vsync";
+        case SwapMode::AdaptiveVSync: return "adaptive";
+        case SwapMode::Uncapped: return "uncapped";
+    }
+    return "unknown";
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <cstdint>
+#include <ostream>
+
+// how buffer swaps are synchronized with the display
+enum class SwapMode{
+    VSync,          // wait for vertical blank
+    AdaptiveVSync,  // wait for vertical blank unless the frame is late (tears instead of stuttering)
+    Uncapped        // never wait
+};
+
+// Paces the render loop to a target frame rate.
+//
+// Each frame has an absolute deadline one period after the previous one, so the error of a single
+// wait doesn't accumulate. The wait sleeps for most of the remaining time and spins for the last
+// SPIN_THRESHOLD_NS, because OS sleeps routinely overshoot by a millisecond or more.
+// The interval between consecutive frames is recorded to report the pacing jitter.
+class FramePacer{
+
+    public:
+        // wake up this long before the deadline and spin for the rest
+        static constexpr uint64_t SPIN_THRESHOLD_NS{2000000};
+
+        FramePacer();
+
+        // targetFps <= 0 disables the software limit (the swap mode may still cap the rate)
+        void setTargetFps(double targetFps);
+
+        // applies the swap interval to the current GL context, falling back to plain vsync
+        // when adaptive vsync isn't supported. Returns the mode actually in use.
+        SwapMode setSwapMode(SwapMode mode);
+
+        // blocks until the next frame deadline, returns the seconds elapsed since the previous frame
+        double waitForNextFrame();
+
+        // forgets the previous frame, e.g. after the loop slept on purpose (idle mode)
+        void resetTiming();
+
+        // mean, standard deviation and worst deviation of the frame interval from the target
+        void report(std::ostream &out) const;
+
+        double getJitterMs() const;
+
+        static bool parseSwapMode(const char *name, SwapMode &mode);
+        static const char *swapModeName(SwapMode mode);
+
+    private:
+        uint64_t periodNS;
+        uint64_t nextDeadline;
+        uint64_t lastFrame;
+
+        // interval statistics, in milliseconds
+        uint64_t intervalCount;
+        double intervalSum;
+        double intervalSumSquares;
+        double maxDeviation;
+
+        void sleepUntil(uint64_t deadline) const;
+        void recordInterval(double intervalMs);
+};
+
+#endif //!_FRAME_PACER_HPP
@@ -0,0 +1,208 @@
+#include "FrameProfiler.hpp"
+#include "glad/include/glad/glad.h"
+
+#include <SDL3/SDL_timer.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+FrameProfiler::FrameProfiler(){
+
+    enabled = false;
+    phaseCount = 0;
+    frameSlot = 0;
+    frameStart = 0;
+    droppedQueries = 0;
+
+}
+
+FrameProfiler::~FrameProfiler(){
+
+    if(!enabled){
+        return;
+    }
+
+    for(int i = 0; i < phaseCount; i++){
+        if(phases[i].gpu){
+            glDeleteQueries(GPU_LATENCY, phases[i].queries);
+        }
+    }
+
+}
+
+void FrameProfiler::enable(){
+
+    if(enabled){
+        return;
+    }
+    enabled = true;
+
+    for(int i = 0; i < phaseCount; i++){
+        if(phases[i].gpu){
+            glGenQueries(GPU_LATENCY, phases[i].queries);
+        }
+    }
+
+}
+
+int FrameProfiler::addPhase(const char *name, bool gpu){
+
+    if(phaseCount == MAX_PHASES){
+        return -1;
+    }
+
+    Phase &phase = phases[phaseCount];
+    phase.name = name;
+    phase.gpu = gpu;
+    phase.cpuStart = 0;
+    for(int i = 0; i < GPU_LATENCY; i++){
+        phase.queries[i] = 0;
+        phase.pending[i] = false;
+    }
+    if(enabled && gpu){
+        glGenQueries(GPU_LATENCY, phase.queries);
+    }
+
+    return phaseCount++;
+}
+
+void FrameProfiler::beginFrame(){
+
+    if(!enabled){
+        return;
+    }
+
+    frameSlot = (frameSlot + 1) % GPU_LATENCY;
+    // the queries of this slot were issued GPU_LATENCY frames ago, take whatever results are ready
+    collectQueries(frameSlot);
+    frameStart = SDL_GetPerformanceCounter();
+
+}
+
+void FrameProfiler::endFrame(){
+
+    if(!enabled){
+        return;
+    }
+
+    frameTimes.push(toMilliseconds(SDL_GetPerformanceCounter() - frameStart));
+
+}
+
+void FrameProfiler::beginPhase(int id){
+
+    if(!enabled || id < 0){
+        return;
+    }
+
+    Phase &phase = phases[id];
+    if(phase.gpu){
+        glBeginQuery(GL_TIME_ELAPSED, phase.queries[frameSlot]);
+    }
+    phase.cpuStart = SDL_GetPerformanceCounter();
+
+}
+
+void FrameProfiler::endPhase(int id){
+
+    if(!enabled || id < 0){
+        return;
+    }
+
+    Phase &phase = phases[id];
+    phase.cpu.push(toMilliseconds(SDL_GetPerformanceCounter() - phase.cpuStart));
+    if(phase.gpu){
+        glEndQuery(GL_TIME_ELAPSED);
+        phase.pending[frameSlot] = true;
+    }
+
+}
+
+void FrameProfiler::collectQueries(int slot){
+
+    for(int i = 0; i < phaseCount; i++){
+        Phase &phase = phases[i];
+        if(!phase.gpu || !phase.pending[slot]){
+            continue;
+        }
+
+        int available{0};
+        glGetQueryObjectiv(phase.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available){
+            GLuint64 elapsed{0};
+            glGetQueryObjectui64v(phase.queries[slot], GL_QUERY_RESULT, &elapsed);
+            phase.gpuSamples.push(elapsed / 1000000.0);
+        } else {
+            // still in flight after GPU_LATENCY frames: drop it rather than wait
+            droppedQueries++;
+        }
+        phase.pending[slot] = false;
+    }
+
+}
+
+void FrameProfiler::report(std::ostream &out) const{
+
+    if(!enabled){
+        return;
+    }
+
+    out << "Frame timings (ms, last " << SAMPLE_CAPACITY << " samples):" << std::endl;
+    out << std::left << std::setw(24) << "phase" << std::right
+        << std::setw(8) << "n" << std::setw(10) << "p50" << std::setw(10) << "p95"
+        << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+
+    reportRing(out, "frame (cpu)", frameTimes);
+    for(int i = 0; i < phaseCount; i++){
+        std::string cpuLabel = std::string(phases[i].name) + " (cpu)";
+        reportRing(out, cpuLabel.c_str(), phases[i].cpu);
+        if(phases[i].gpu){
+            std::string gpuLabel = std::string(phases[i].name) + " (gpu)";
+            reportRing(out, gpuLabel.c_str(), phases[i].gpuSamples);
+        }
+    }
+
+    if(droppedQueries > 0){
+        out << "GPU queries dropped (not ready in time): " << droppedQueries << std::endl;
+    }
+
+}
+
+void FrameProfiler::reportRing(std::ostream &out, const char *label, const SampleRing &ring){
+
+    if(ring.count == 0){
+        return;
+    }
+
+    std::vector<float> sorted(ring.samples.begin(), ring.samples.begin() + ring.count);
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&sorted](double p){
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[index];
+    };
+
+    out << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(3)
+        << std::setw(8) << ring.count
+        << std::setw(10) << percentile(0.50) << std::setw(10) << percentile(0.95)
+        << std::setw(10) << percentile(0.99) << std::setw(10) << sorted.back() << std::endl;
+
+}
+
+double FrameProfiler::toMilliseconds(uint64_t ticks){
+
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+
+}
+
+void FrameProfiler::SampleRing::push(float value){
+
+    samples[next] = value;
+    next = (next + 1) % SAMPLE_CAPACITY;
+    if(count < SAMPLE_CAPACITY){
+        count++;
+    }
+
+}
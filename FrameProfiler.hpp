@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef FRAME_PROFILER_HPP
+#define FRAME_PROFILER_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+// Per-phase frame timing.
+//
+// CPU phases are measured with the performance counter, GPU phases with GL_TIME_ELAPSED queries.
+// GPU queries are kept in a ring of GPU_LATENCY frames and only read back once the driver reports
+// them available, so profiling never stalls the pipeline. Every phase keeps its last SAMPLE_CAPACITY
+// samples in a fixed ring buffer; report() prints p50/p95/p99/max over them.
+//
+// GL_TIME_ELAPSED queries can't nest: at most one GPU phase may be open at a time.
+class FrameProfiler{
+
+    public:
+        static constexpr int MAX_PHASES{16};
+        static constexpr int SAMPLE_CAPACITY{1024};
+        static constexpr int GPU_LATENCY{4};
+
+        FrameProfiler();
+        ~FrameProfiler();
+
+        FrameProfiler(const FrameProfiler &) = delete;
+        FrameProfiler &operator=(const FrameProfiler &) = delete;
+
+        // enables profiling, needs a current GL context if GPU phases are used
+        void enable();
+        bool isEnabled() const {return enabled;}
+
+        // registers a phase and returns its id, names must outlive the profiler
+        int addPhase(const char *name, bool gpu);
+
+        void beginFrame();
+        void endFrame();
+
+        void beginPhase(int phase);
+        void endPhase(int phase);
+
+        // prints the percentiles of every phase that has samples
+        void report(std::ostream &out) const;
+
+    private:
+        struct SampleRing{
+            std::array<float, SAMPLE_CAPACITY> samples;
+            int count{0};
+            int next{0};
+
+            void push(float value);
+        };
+
+        struct Phase{
+            const char *name;
+            bool gpu;
+            uint64_t cpuStart;
+            SampleRing cpu;
+            SampleRing gpuSamples;
+            unsigned int queries[GPU_LATENCY];
+            bool pending[GPU_LATENCY];
+        };
+
+        bool enabled;
+        int phaseCount;
+        std::array<Phase, MAX_PHASES> phases;
+
+        int frameSlot;
+        uint64_t frameStart;
+        SampleRing frameTimes;
+
+        unsigned long droppedQueries;
+
+        static double toMilliseconds(uint64_t ticks);
+        void collectQueries(int slot);
+        static void reportRing(std::ostream &out, const char *label, const SampleRing &ring);
+};
+
+// times a phase for the lifetime of the object
+class ProfileScope{
+
+    public:
+        ProfileScope(FrameProfiler &profiler, int phase) : profiler(profiler), phase(phase){
+            profiler.beginPhase(phase);
+        }
+
+        ~ProfileScope(){
+            profiler.endPhase(phase);
+        }
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+    private:
+        FrameProfiler &profiler;
+        int phase;
+};
+
+#endif //!_FRAME_PROFILER_HPP
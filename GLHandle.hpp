@@ -0,0 +1,82 @@
+#ifndef GL_HANDLE_HPP
+#define GL_HANDLE_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include "GLState.hpp"
+
+// how each kind of GL object is created and deleted
+struct GLBufferTraits {
+    static void create(unsigned int &id){ glGenBuffers(1, &id); }
+    static void destroy(unsigned int id){ glDeleteBuffers(1, &id); }
+};
+
+struct GLVertexArrayTraits {
+    static void create(unsigned int &id){ glGenVertexArrays(1, &id); }
+    static void destroy(unsigned int id){
+        // a deleted VAO is unbound by GL, the state cache has to follow
+        GLState::instance().forgetVertexArray(id);
+        glDeleteVertexArrays(1, &id);
+    }
+};
+
+// Sole owner of one GL object name: the object is deleted with its handle, and moving the handle
+// hands the name over, so whatever holds one can live in a vector without leaking or double deletes.
+// Must be reset or destroyed while the context that created it is current.
+template<typename Traits>
+class GLHandle {
+public:
+    GLHandle() : id(0){}
+
+    ~GLHandle()
+    {
+        reset();
+    }
+
+    GLHandle(const GLHandle &) = delete;
+    GLHandle &operator=(const GLHandle &) = delete;
+
+    GLHandle(GLHandle &&other) noexcept : id(other.id)
+    {
+        other.id = 0;
+    }
+
+    GLHandle &operator=(GLHandle &&other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    // replaces the object with a new one
+    void create()
+    {
+        reset();
+        Traits::create(id);
+    }
+
+    void reset()
+    {
+        if(id != 0)
+        {
+            Traits::destroy(id);
+            id = 0;
+        }
+    }
+
+    unsigned int get() const { return id; }
+
+    explicit operator bool() const { return id != 0; }
+
+private:
+    unsigned int id;
+};
+
+using GLBuffer = GLHandle<GLBufferTraits>;
+using GLVertexArray = GLHandle<GLVertexArrayTraits>;
+
+#endif //!_GL_HANDLE_HPP
@@ -0,0 +1,198 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+// Shadow copy of the GL state the renderer changes: bound program, VAO, 2D texture per unit,
+// active texture unit, depth test/blend/cull enables and the blend function. Every change goes
+// through here, so a call that would set the value already in place is dropped before it reaches
+// the driver. The cache is only valid for the context it was used with and only as long as nobody
+// changes that state behind its back; invalidate() forgets everything.
+class GLState{
+
+    public:
+        static constexpr int MAX_TEXTURE_UNITS{16};
+
+        // the state of the current context; the renderer uses a single context on a single thread
+        static GLState &instance(){
+            static GLState state;
+            return state;
+        }
+
+        GLState(const GLState &) = delete;
+        GLState &operator=(const GLState &) = delete;
+
+        void useProgram(unsigned int program){
+            if(program == currentProgram){
+                skipped++;
+                return;
+            }
+            glUseProgram(program);
+            currentProgram = program;
+            issued++;
+        }
+
+        void bindVertexArray(unsigned int vao){
+            if(vao == currentVAO){
+                skipped++;
+                return;
+            }
+            glBindVertexArray(vao);
+            currentVAO = vao;
+            issued++;
+        }
+
+        void activeTexture(int unit){
+            if(unit == currentUnit){
+                skipped++;
+                return;
+            }
+            glActiveTexture(GL_TEXTURE0 + unit);
+            currentUnit = unit;
+            issued++;
+        }
+
+        // binds a 2D texture to a unit, switching the active unit only when the binding changes
+        void bindTexture(int unit, unsigned int texture){
+            if(unit < MAX_TEXTURE_UNITS && textures[unit] == texture){
+                skipped++;
+                return;
+            }
+            activeTexture(unit);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            if(unit < MAX_TEXTURE_UNITS){
+                textures[unit] = texture;
+            }
+            issued++;
+        }
+
+        // GL_DEPTH_TEST, GL_BLEND or GL_CULL_FACE, other capabilities go straight to the driver
+        void setEnabled(GLenum capability, bool enabled){
+            int8_t *cached = capabilityState(capability);
+            if(cached && *cached == (enabled ? 1 : 0)){
+                skipped++;
+                return;
+            }
+            if(enabled){
+                glEnable(capability);
+            } else {
+                glDisable(capability);
+            }
+            if(cached){
+                *cached = enabled ? 1 : 0;
+            }
+            issued++;
+        }
+
+        void blendFunc(GLenum source, GLenum destination){
+            if(source == blendSource && destination == blendDestination){
+                skipped++;
+                return;
+            }
+            glBlendFunc(source, destination);
+            blendSource = source;
+            blendDestination = destination;
+            issued++;
+        }
+
+        // a deleted object is unbound by GL, the cache has to follow
+        void forgetProgram(unsigned int program){
+            if(currentProgram == program){
+                currentProgram = UNKNOWN;
+            }
+        }
+
+        void forgetVertexArray(unsigned int vao){
+            if(currentVAO == vao){
+                currentVAO = UNKNOWN;
+            }
+        }
+
+        void forgetTexture(unsigned int texture){
+            for(unsigned int &bound : textures){
+                if(bound == texture){
+                    bound = UNKNOWN;
+                }
+            }
+        }
+
+        // forgets all cached state, the next call of each kind reaches the driver
+        void invalidate(){
+            currentProgram = UNKNOWN;
+            currentVAO = UNKNOWN;
+            currentUnit = -1;
+            for(unsigned int &bound : textures){
+                bound = UNKNOWN;
+            }
+            depthTest = blend = cullFace = -1;
+            blendSource = blendDestination = UNKNOWN;
+        }
+
+        // counts the calls of one frame, everything outside beginFrame/endFrame (loading, setup) is left out
+        void beginFrame(){
+            skipped = 0;
+            issued = 0;
+        }
+
+        void endFrame(){
+            lastSkipped = skipped;
+            lastIssued = issued;
+            totalSkipped += skipped;
+            totalIssued += issued;
+            frames++;
+        }
+
+        uint64_t getSkippedLastFrame() const { return lastSkipped; }
+        uint64_t getIssuedLastFrame() const { return lastIssued; }
+
+        void report(std::ostream &out) const{
+            if(frames == 0){
+                return;
+            }
+            out << std::fixed << std::setprecision(1)
+                << "GL state: " << (static_cast<double>(totalSkipped) / frames) << " redundant calls skipped, "
+                << (static_cast<double>(totalIssued) / frames) << " issued per frame (last frame "
+                << lastSkipped << " skipped, " << lastIssued << " issued)" << std::endl;
+        }
+
+    private:
+        static constexpr unsigned int UNKNOWN{0xFFFFFFFFu};
+
+        unsigned int currentProgram;
+        unsigned int currentVAO;
+        int currentUnit;
+        unsigned int textures[MAX_TEXTURE_UNITS];
+        // -1 unknown, 0 disabled, 1 enabled
+        int8_t depthTest;
+        int8_t blend;
+        int8_t cullFace;
+        GLenum blendSource;
+        GLenum blendDestination;
+
+        uint64_t skipped;
+        uint64_t issued;
+        uint64_t lastSkipped;
+        uint64_t lastIssued;
+        uint64_t totalSkipped;
+        uint64_t totalIssued;
+        uint64_t frames;
+
+        GLState() : skipped(0), issued(0), lastSkipped(0), lastIssued(0), totalSkipped(0), totalIssued(0), frames(0){
+            invalidate();
+        }
+
+        int8_t *capabilityState(GLenum capability){
+            switch(capability){
+                case GL_DEPTH_TEST: return &depthTest;
+                case GL_BLEND: return &blend;
+                case GL_CULL_FACE: return &cullFace;
+                default: return nullptr;
+            }
+        }
+};
+
+#endif //!_GL_STATE_HPP
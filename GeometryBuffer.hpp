@@ -0,0 +1,386 @@
+#ifndef GEOMETRY_BUFFER_HPP
+#define GEOMETRY_BUFFER_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include "GLHandle.hpp"
+#include "GLState.hpp"
+#include "Mesh.hpp"
+#include "ClockInstances.hpp"
+#include "Shader.hpp"
+#include "ShaderVariants.hpp"
+#include "Trace.hpp"
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// where a mesh's vertices and indices are read from while the geometry buffer is built
+struct MeshData {
+    const Vertex *vertices;
+    size_t vertexCount;
+    const unsigned int *indices;
+    size_t indexCount;
+    // levels of detail inside indices, none when they are a single level
+    const MeshLod *lods;
+    size_t lodCount;
+};
+
+// the given level of detail of a mesh, its coarsest one when it has fewer
+inline MeshLod meshLevel(const MeshData &source, size_t level)
+{
+    if(source.lodCount == 0)
+        return MeshLod{0, static_cast<uint32_t>(source.indexCount), 0.0f};
+    return source.lods[std::min(level, source.lodCount - 1)];
+}
+
+// Holds the geometry of every mesh of a model in a single vertex buffer and a single index buffer.
+// Indices stay relative to each mesh and are offset with a base vertex at draw time, so 16-bit
+// indices are used whenever every individual mesh has fewer than 65536 vertices.
+// Meshes sharing the same textures are submitted together with one glMultiDrawElementsBaseVertex,
+// so the number of draw calls follows the number of materials, not the number of meshes. What each
+// of those calls needs is resolved into an immutable DrawRecord when the buffer is built.
+// Every level of detail of the meshes is in the same index buffer; a draw picks one level for the
+// whole model, each mesh contributing its own range for it (see selectLod).
+template<typename Layout>
+class BasicGeometryBuffer {
+public:
+    using Packed = typename Layout::Packed;
+
+    // the buffers are released with their handles
+    BasicGeometryBuffer() : indexType(GL_UNSIGNED_INT), drawsPerLevel(0), boundsCenter(0.0f), boundsRadius(0.0f){}
+
+    BasicGeometryBuffer(const BasicGeometryBuffer &) = delete;
+    BasicGeometryBuffer &operator=(const BasicGeometryBuffer &) = delete;
+
+    // uploads the CPU-side arrays of the meshes
+    void build(std::vector<BasicMesh<Layout>> &meshes)
+    {
+        std::vector<MeshData> sources;
+        sources.reserve(meshes.size());
+        for(const BasicMesh<Layout> &mesh : meshes)
+            sources.push_back({mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), mesh.lods.data(), mesh.lods.size()});
+        build(meshes, sources);
+    }
+
+    // uploads sources[i] as the geometry of meshes[i] and assigns each mesh its range in the shared buffers
+    void build(std::vector<BasicMesh<Layout>> &meshes, const std::vector<MeshData> &sources)
+    {
+        TRACE_SCOPE("geometry upload");
+        release();
+
+        size_t totalVertices = 0;
+        size_t totalIndices = 0;
+        size_t largestMesh = 0;
+        for(const MeshData &source : sources)
+        {
+            totalVertices += source.vertexCount;
+            totalIndices += source.indexCount;
+            largestMesh = std::max(largestMesh, source.vertexCount);
+        }
+        indexType = largestMesh <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        VAO.create();
+        VBO.create();
+        EBO.create();
+
+        GLState::instance().bindVertexArray(VAO.get());
+        glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+        glBufferData(GL_ARRAY_BUFFER, totalVertices * sizeof(Packed), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalIndices * indexSize, nullptr, GL_STATIC_DRAW);
+
+        size_t vertexOffset = 0;
+        size_t indexOffset = 0;
+        glm::vec3 low(0.0f);
+        glm::vec3 high(0.0f);
+        bool bounded = false;
+        std::vector<Packed> packed;
+        std::vector<uint16_t> shortIndices;
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            const MeshData &source = sources[i];
+            BasicMesh<Layout> &mesh = meshes[i];
+
+            // load data into the vertex buffer, converted to the layout's packed format
+            if constexpr (std::is_same_v<Packed, Vertex>)
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * sizeof(Packed), source.vertexCount * sizeof(Packed), source.vertices);
+            }
+            else
+            {
+                packed.resize(source.vertexCount);
+                for(size_t v = 0; v < source.vertexCount; v++)
+                    packed[v] = Layout::pack(source.vertices[v]);
+                glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * sizeof(Packed), source.vertexCount * sizeof(Packed), packed.data());
+            }
+
+            if(indexType == GL_UNSIGNED_SHORT)
+            {
+                shortIndices.assign(source.indices, source.indices + source.indexCount);
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * indexSize, source.indexCount * indexSize, shortIndices.data());
+            }
+            else
+            {
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * indexSize, source.indexCount * indexSize, source.indices);
+            }
+
+            mesh.VAO = VAO.get();
+            mesh.vertexCount = static_cast<unsigned int>(source.vertexCount);
+            mesh.baseVertex = static_cast<int>(vertexOffset);
+            mesh.firstIndex = indexOffset * indexSize;
+            mesh.indexCount = meshLevel(source, 0).indexCount;
+            mesh.indexType = indexType;
+
+            for(size_t v = 0; v < source.vertexCount; v++)
+            {
+                low = bounded ? glm::min(low, source.vertices[v].Position) : source.vertices[v].Position;
+                high = bounded ? glm::max(high, source.vertices[v].Position) : source.vertices[v].Position;
+                bounded = true;
+            }
+
+            vertexOffset += source.vertexCount;
+            indexOffset += source.indexCount;
+        }
+
+        // set the vertex attribute pointers described by the layout
+        for(const VertexAttribute &attribute : Layout::attributes)
+        {
+            glEnableVertexAttribArray(attribute.location);
+            if(attribute.integer)
+                glVertexAttribIPointer(attribute.location, attribute.components, attribute.type, sizeof(Packed), (void*)attribute.offset);
+            else
+                glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, sizeof(Packed), (void*)attribute.offset);
+        }
+
+        boundsCenter = (low + high) * 0.5f;
+        boundsRadius = glm::length(high - low) * 0.5f;
+
+        buildRecords(meshes, sources);
+    }
+
+    // draws every mesh at the given level of detail with shader, one multi-draw per material. The
+    // shader's samplers must read from the fixed texture units (see textureUnit)
+    void Draw(Shader &shader, size_t lod = 0) const
+    {
+        if(records.empty())
+            return;
+
+        shader.use();
+        GLState::instance().bindVertexArray(VAO.get());
+        for(const DrawRecord &record : records)
+        {
+            bindRecordTextures(record);
+            multiDraw(record, lod);
+        }
+    }
+
+    // draws each record with the model shader variant its material selects. The per-object uniforms
+    // are applied whenever the variant changes, so objects can mix materials freely.
+    void Draw(ShaderVariants &variants, uint32_t sceneFeatures, const ObjectUniforms &object, size_t lod = 0) const
+    {
+        if(records.empty())
+            return;
+
+        const ShaderVariant *current = nullptr;
+        GLState::instance().bindVertexArray(VAO.get());
+        for(const DrawRecord &record : records)
+        {
+            ShaderVariant &variant = variants.get(sceneFeatures | record.features);
+            if(&variant != current)
+            {
+                variant.shader.use();
+                variant.shader.setMat4(variant.model, object.model);
+                variant.shader.setFloat(variant.materialShininess, object.shininess);
+                variant.shader.setInt(variant.hand, object.hand);
+                current = &variant;
+            }
+            bindRecordTextures(record);
+            multiDraw(record, lod);
+        }
+    }
+
+    // adds the per-instance attributes of a clock wall to this buffer's VAO
+    void attachInstances(ClockInstances &instances)
+    {
+        GLState::instance().bindVertexArray(VAO.get());
+        instances.bindAttributes();
+    }
+
+    // draws every mesh once for all the instances attached with attachInstances, rotating it by the
+    // angle of the given clock part
+    void DrawInstanced(ShaderVariants &variants, uint32_t sceneFeatures, ClockPart part, float shininess, GLsizei instanceCount, size_t lod = 0) const
+    {
+        if(records.empty() || instanceCount == 0)
+            return;
+
+        const ShaderVariant *current = nullptr;
+        GLState::instance().bindVertexArray(VAO.get());
+        for(const DrawRecord &record : records)
+        {
+            ShaderVariant &variant = variants.get(sceneFeatures | SHADER_INSTANCED | record.features);
+            if(&variant != current)
+            {
+                variant.shader.use();
+                variant.shader.setInt(variant.hand, part);
+                variant.shader.setFloat(variant.materialShininess, shininess);
+                current = &variant;
+            }
+            bindRecordTextures(record);
+            size_t first = levelOffset(lod) + record.firstDraw;
+            for(size_t i = first; i < first + record.drawCount; i++)
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, counts[i], record.indexType, offsets[i], instanceCount, baseVertices[i]);
+        }
+    }
+
+    // the coarsest level of detail whose error stays within LOD_PIXEL_ERROR, for a model drawn at
+    // pixelsPerUnit screen pixels per model unit
+    size_t selectLod(float pixelsPerUnit) const
+    {
+        size_t lod = 0;
+        for(size_t level = 1; level < levelErrors.size(); level++)
+        {
+            if(levelErrors[level] * pixelsPerUnit <= LOD_PIXEL_ERROR)
+                lod = level;
+        }
+        return lod;
+    }
+
+    size_t getLodCount() const { return levelErrors.size(); }
+
+    // sphere around every vertex, in model space
+    const glm::vec3 &getBoundsCenter() const { return boundsCenter; }
+    float getBoundsRadius() const { return boundsRadius; }
+
+    size_t getBatchCount() const { return records.size(); }
+
+    const std::vector<DrawRecord> &getDrawRecords() const { return records; }
+
+private:
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
+    GLenum indexType;
+
+    // one record per material, drawing a contiguous range of the arrays below. The arrays hold one
+    // block of drawsPerLevel draws per level of detail, in the same order in every block.
+    std::vector<DrawRecord> records;
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+    size_t drawsPerLevel;
+    // error of each level of detail, the largest of its meshes'
+    std::vector<float> levelErrors;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+
+    size_t levelOffset(size_t lod) const
+    {
+        return std::min(lod, levelErrors.size() - 1) * drawsPerLevel;
+    }
+
+    void multiDraw(const DrawRecord &record, size_t lod) const
+    {
+        size_t first = levelOffset(lod) + record.firstDraw;
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data() + first, record.indexType, offsets.data() + first, static_cast<GLsizei>(record.drawCount), baseVertices.data() + first);
+    }
+
+    static bool sameTextures(const std::vector<Texture> &a, const std::vector<Texture> &b)
+    {
+        if(a.size() != b.size())
+            return false;
+        for(size_t i = 0; i < a.size(); i++)
+        {
+            if(a[i].id != b[i].id || a[i].type != b[i].type)
+                return false;
+        }
+        return true;
+    }
+
+    // groups the meshes by material, keeping the order in which each material first appears, and
+    // resolves each group into a draw record
+    void buildRecords(std::vector<BasicMesh<Layout>> &meshes, const std::vector<MeshData> &sources)
+    {
+        std::vector<std::vector<size_t>> groups;
+        std::vector<size_t> groupOwners;
+        for(size_t i = 0; i < meshes.size(); i++)
+        {
+            BasicMesh<Layout> &mesh = meshes[i];
+            mesh.record = DrawRecord{};
+            mesh.record.VAO = mesh.VAO;
+            mesh.record.indexType = mesh.indexType;
+            setRecordTextures(mesh.record, mesh.textures);
+            mesh.record.features = materialFeatures(mesh.record);
+            if(mesh.indexCount == 0)
+                continue;
+
+            size_t group = 0;
+            while(group < groups.size() && !sameTextures(meshes[groupOwners[group]].textures, mesh.textures))
+                group++;
+            if(group == groups.size())
+            {
+                groups.emplace_back();
+                groupOwners.push_back(i);
+            }
+            groups[group].push_back(i);
+        }
+
+        size_t levels = 1;
+        drawsPerLevel = 0;
+        for(const std::vector<size_t> &members : groups)
+        {
+            drawsPerLevel += members.size();
+            for(size_t index : members)
+                levels = std::max(levels, sources[index].lodCount);
+        }
+
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        records.clear();
+        records.reserve(groups.size());
+        counts.resize(drawsPerLevel * levels);
+        offsets.resize(drawsPerLevel * levels);
+        baseVertices.resize(drawsPerLevel * levels);
+        levelErrors.assign(levels, 0.0f);
+        size_t draw = 0;
+        for(size_t group = 0; group < groups.size(); group++)
+        {
+            DrawRecord record = meshes[groupOwners[group]].record;
+            record.firstDraw = static_cast<uint32_t>(draw);
+            record.drawCount = static_cast<uint32_t>(groups[group].size());
+            for(size_t index : groups[group])
+            {
+                const BasicMesh<Layout> &mesh = meshes[index];
+                for(size_t level = 0; level < levels; level++)
+                {
+                    MeshLod lod = meshLevel(sources[index], level);
+                    size_t slot = level * drawsPerLevel + draw;
+                    counts[slot] = static_cast<GLsizei>(lod.indexCount);
+                    offsets[slot] = reinterpret_cast<const void*>(mesh.firstIndex + lod.firstIndex * indexSize);
+                    baseVertices[slot] = mesh.baseVertex;
+                    levelErrors[level] = std::max(levelErrors[level], lod.error);
+                }
+                draw++;
+            }
+            records.push_back(record);
+        }
+    }
+
+    void release()
+    {
+        VAO.reset();
+        VBO.reset();
+        EBO.reset();
+        records.clear();
+        counts.clear();
+        offsets.clear();
+        baseVertices.clear();
+        levelErrors.clear();
+        drawsPerLevel = 0;
+    }
+};
+
+using GeometryBuffer = BasicGeometryBuffer<DefaultVertexLayout>;
+
+#endif //!_GEOMETRY_BUFFER_HPP
@@ -0,0 +1,167 @@
+#include "Headless.hpp"
+#include "glad/include/glad/glad.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+HeadlessContext::HeadlessContext(){
+
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+
+    width = 0;
+    height = 0;
+
+    FBO = 0;
+    colorRBO = 0;
+    depthRBO = 0;
+}
+
+HeadlessContext::~HeadlessContext(){
+
+    if(FBO != 0){
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteRenderbuffers(1, &colorRBO);
+        glDeleteRenderbuffers(1, &depthRBO);
+    }
+
+    if(display != EGL_NO_DISPLAY){
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(context != EGL_NO_CONTEXT){
+            eglDestroyContext(display, context);
+        }
+        if(surface != EGL_NO_SURFACE){
+            eglDestroySurface(display, surface);
+        }
+        eglTerminate(display);
+    }
+}
+
+bool HeadlessContext::initialize(int width, int height){
+
+    this->width = width;
+    this->height = height;
+
+    // prefer Mesa's surfaceless platform: it needs neither a GPU nor an X/Wayland server
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if(clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless")){
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if(getPlatformDisplay){
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+    if(display == EGL_NO_DISPLAY){
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)){
+        std::cout << "ERROR::HEADLESS::EGL_DISPLAY_UNAVAILABLE" << std::endl;
+        return false;
+    }
+
+    const char *displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    bool surfaceless = displayExtensions && std::strstr(displayExtensions, "EGL_KHR_surfaceless_context");
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount{0};
+    if(!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0){
+        std::cout << "ERROR::HEADLESS::NO_EGL_CONFIG" << std::endl;
+        return false;
+    }
+
+    if(!surfaceless){
+        const EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        if(surface == EGL_NO_SURFACE){
+            std::cout << "ERROR::HEADLESS::PBUFFER_CREATION_FAILED" << std::endl;
+            return false;
+        }
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if(context == EGL_NO_CONTEXT){
+        std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED" << std::endl;
+        return false;
+    }
+
+    if(!eglMakeCurrent(display, surface, surface, context)){
+        std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool HeadlessContext::createFramebuffer(){
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    glGenRenderbuffers(1, &colorRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+
+    glGenRenderbuffers(1, &depthRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+        std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return false;
+    }
+
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, width, height);
+
+    return true;
+}
+
+bool HeadlessContext::dumpFrame(const std::string &path) const{
+
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream out(path, std::ios::binary);
+    if(!out){
+        std::cout << "ERROR::HEADLESS::CANNOT_WRITE_FRAME " << path << std::endl;
+        return false;
+    }
+
+    out << "P6\n" << width << " " << height << "\n255\n";
+    // GL rows go bottom-up, PPM rows top-down
+    for(int y = height - 1; y >= 0; y--){
+        out.write(reinterpret_cast<const char *>(&pixels[static_cast<size_t>(y) * width * 3]), width * 3);
+    }
+
+    return static_cast<bool>(out);
+}
+
+void *HeadlessContext::getProcAddress(const char *name){
+
+    return reinterpret_cast<void *>(eglGetProcAddress(name));
+
+}
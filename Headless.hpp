@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <EGL/egl.h>
+
+#include <string>
+
+// Offscreen OpenGL context for running the renderer without a display (e.g. on CI with Mesa's llvmpipe).
+// Uses an EGL surfaceless context when the driver supports it, a 1x1 pbuffer otherwise,
+// and renders into a framebuffer object of the requested size.
+class HeadlessContext{
+
+    public:
+        HeadlessContext();
+        ~HeadlessContext();
+
+        HeadlessContext(const HeadlessContext &) = delete;
+        HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+        // creates the EGL context and makes it current, call before loading GL functions
+        bool initialize(int width, int height);
+
+        // creates the framebuffer object and binds it, call after GL functions were loaded
+        bool createFramebuffer();
+
+        // writes the current contents of the framebuffer as a binary PPM image
+        bool dumpFrame(const std::string &path) const;
+
+        // GL function loader for glad
+        static void *getProcAddress(const char *name);
+
+        int getWidth() const {return width;}
+        int getHeight() const {return height;}
+
+    private:
+        EGLDisplay display;
+        EGLContext context;
+        EGLSurface surface;
+
+        int width;
+        int height;
+
+        unsigned int FBO;
+        unsigned int colorRBO;
+        unsigned int depthRBO;
+};
+
+#endif //!_HEADLESS_HPP
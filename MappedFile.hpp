@@ -0,0 +1,109 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped when it goes out of scope.
+class MappedFile{
+
+    public:
+        MappedFile() : mapping(nullptr), length(0){}
+
+        explicit MappedFile(const std::string &path) : mapping(nullptr), length(0){
+            open(path);
+        }
+
+        ~MappedFile(){
+            close();
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept : mapping(other.mapping), length(other.length){
+            other.mapping = nullptr;
+            other.length = 0;
+        }
+
+        MappedFile &operator=(MappedFile &&other) noexcept{
+            if(this != &other){
+                close();
+                mapping = other.mapping;
+                length = other.length;
+                other.mapping = nullptr;
+                other.length = 0;
+            }
+            return *this;
+        }
+
+        // maps the file, returns false if it doesn't exist, is empty or can't be mapped
+        bool open(const std::string &path){
+            close();
+
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0){
+                return false;
+            }
+
+            struct stat info;
+            if(fstat(fd, &info) != 0 || info.st_size <= 0){
+                ::close(fd);
+                return false;
+            }
+
+            void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            // the mapping keeps its own reference to the file
+            ::close(fd);
+            if(address == MAP_FAILED){
+                return false;
+            }
+
+            mapping = static_cast<const unsigned char *>(address);
+            length = static_cast<std::size_t>(info.st_size);
+            return true;
+        }
+
+        void close(){
+            if(mapping){
+                munmap(const_cast<unsigned char *>(mapping), length);
+                mapping = nullptr;
+                length = 0;
+            }
+        }
+
+        bool isOpen() const { return mapping != nullptr; }
+        const unsigned char *data() const { return mapping; }
+        std::size_t size() const { return length; }
+
+    private:
+        const unsigned char *mapping;
+        std::size_t length;
+};
+
+// 64-bit FNV-1a, used to key on-disk caches on the content of their source files
+inline uint64_t hashBytes(const unsigned char *data, std::size_t size, uint64_t hash = 14695981039346656037ull){
+    for(std::size_t i = 0; i < size; i++){
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// hashes the content of a file, returns false if it can't be read
+inline bool hashFile(const std::string &path, uint64_t &hash){
+    MappedFile file;
+    if(!file.open(path)){
+        return false;
+    }
+    hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+#endif //!_MAPPED_FILE_HPP
@@ -8,141 +8,170 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "GLState.hpp"
 #include "Shader.hpp"
+#include "VertexLayout.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
-#define MAX_BONE_INFLUENCE 4 
-
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-	//bone indexes which will influence this vertex
-	int m_BoneIDs[MAX_BONE_INFLUENCE];
-	//weights from each bone
-	float m_Weights[MAX_BONE_INFLUENCE];
-};
-
 struct Texture {
     unsigned int id;
     std::string type;
     std::string path;
 };
 
-class Mesh {
+// material texture kinds, resolved from the Assimp type names once at load time
+enum class TextureType : uint8_t {
+    Diffuse,
+    Specular,
+    Normal,
+    Height,
+    Count
+};
+
+inline TextureType textureTypeFromName(const std::string &name)
+{
+    if(name == "texture_diffuse")
+        return TextureType::Diffuse;
+    if(name == "texture_specular")
+        return TextureType::Specular;
+    if(name == "texture_normal")
+        return TextureType::Normal;
+    if(name == "texture_height")
+        return TextureType::Height;
+    return TextureType::Count;
+}
+
+// Each texture type has a fixed unit, the samplers of a program are pointed at them once after
+// linking (see ShaderVariant) instead of on every draw.
+constexpr int textureUnit(TextureType type)
+{
+    return static_cast<int>(type);
+}
+
+constexpr size_t MAX_DRAW_TEXTURES{static_cast<size_t>(TextureType::Count)};
+
+struct TextureBinding {
+    unsigned int id;
+    int unit;
+    TextureType type;
+};
+
+// Everything needed to issue a draw, resolved when the geometry is uploaded and never modified
+// afterwards. Textures are stored inline so walking an array of records touches no other memory.
+struct DrawRecord {
+    unsigned int VAO;
+    GLenum indexType;
+    // shader features the material needs (see ShaderVariants.hpp)
+    uint32_t features;
+    // meshes drawn by the record, a range of its owner's count/offset/base vertex arrays
+    uint32_t firstDraw;
+    uint32_t drawCount;
+    uint32_t textureCount;
+    TextureBinding textures[MAX_DRAW_TEXTURES];
+};
+
+// fills in the texture bindings of a record, one texture per type (the first one of each type wins)
+inline void setRecordTextures(DrawRecord &record, const std::vector<Texture> &textures)
+{
+    bool bound[MAX_DRAW_TEXTURES] = {};
+    record.textureCount = 0;
+    for(const Texture &texture : textures)
+    {
+        TextureType type = textureTypeFromName(texture.type);
+        if(type == TextureType::Count || bound[static_cast<size_t>(type)])
+            continue;
+        bound[static_cast<size_t>(type)] = true;
+        record.textures[record.textureCount++] = TextureBinding{texture.id, textureUnit(type), type};
+    }
+}
+
+inline void bindRecordTextures(const DrawRecord &record)
+{
+    GLState &state = GLState::instance();
+    for(uint32_t i = 0; i < record.textureCount; i++)
+        state.bindTexture(record.textures[i].unit, record.textures[i].id);
+}
+
+// levels of detail a mesh can have, the full one included
+constexpr size_t MAX_MESH_LODS{4};
+// screen-space error, in pixels, up to which a coarser level of detail is drawn
+constexpr float LOD_PIXEL_ERROR{1.0f};
+
+// one level of detail of a mesh, a range of its index buffer over the same vertices
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // how far, in model units, the level strays from the full mesh
+    float error;
+};
+
+// A mesh of a model. Its vertices live in the model's shared vertex/index buffers
+// (see GeometryBuffer.hpp), whose GPU vertex format is described at compile time by Layout.
+// The GL objects are owned by that buffer, the mesh only refers to its range in them. Meshes are
+// move-only, so their arrays are never copied on the way from the importer to the model.
+template<typename Layout>
+class BasicMesh {
 public:
-    // mesh Data
+    using Packed = typename Layout::Packed;
+
+    // mesh Data, empty when the data came from outside (e.g. a mapped mesh cache) or was released after upload
     std::vector<Vertex>       vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture>      textures;
-    unsigned int VAO;
-
-    // constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+    // levels of detail inside indices, the full mesh first (see MeshSimplifier.hpp); empty when
+    // the indices are a single level
+    std::vector<MeshLod>      lods;
+
+    // range inside the shared buffers, assigned when the geometry buffer is built
+    unsigned int VAO = 0;
+    unsigned int vertexCount = 0;
+    int baseVertex = 0;
+    size_t firstIndex = 0;   // byte offset into the index buffer
+    unsigned int indexCount = 0;   // of the full level of detail
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum indexType = GL_UNSIGNED_INT;
+    // VAO and texture bindings, filled in with the range
+    DrawRecord record{};
+
+    // constructor, pass the arrays with std::move to hand them over
+    BasicMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)){}
+
+    // for meshes whose vertex and index arrays are handed directly to the geometry buffer
+    explicit BasicMesh(std::vector<Texture> textures)
+        : textures(std::move(textures)){}
+
+    BasicMesh(const BasicMesh &) = delete;
+    BasicMesh &operator=(const BasicMesh &) = delete;
+    BasicMesh(BasicMesh &&) noexcept = default;
+    BasicMesh &operator=(BasicMesh &&) noexcept = default;
+
+    // frees the CPU-side arrays once the geometry buffer holds them
+    void releaseGeometry()
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
     }
 
-    // render the mesh
+    // render the mesh on its own, the shader's samplers must read from the fixed texture units
     void Draw(Shader &shader) 
     {
+        shader.use();
+
         // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            std::string number;
-            std::string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        bindRecordTextures(record);
         
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
-    }
-
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        GLState::instance().bindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, indexType, (void*)firstIndex, baseVertex);
     }
 };
 
+using Mesh = BasicMesh<DefaultVertexLayout>;
+
 #endif //!_MESH_HPP
@@ -0,0 +1,217 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Binary cache of the meshes built from a source model, so warm starts skip the Assimp import.
+//
+// Layout (all fields little endian, every section padded to 4 bytes):
+//   MeshCacheHeader
+//   per mesh: MeshCacheEntry, Vertex[vertexCount], uint32[indexCount] (every level of detail),
+//             MeshLod[lodCount], per texture: uint32 typeLength, uint32 pathLength, type chars, path chars
+
+// bump whenever Vertex, the layout below or what MeshOptimizer/MeshSimplifier produce changes
+constexpr uint32_t MESH_CACHE_VERSION{4};
+constexpr char MESH_CACHE_MAGIC[8] = {'G', 'L', 'C', 'M', 'E', 'S', 'H', '\0'};
+constexpr const char *MESH_CACHE_EXTENSION{".meshcache"};
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint64_t sourceHash;
+    uint32_t importFlags;
+    uint32_t meshCount;
+};
+
+struct MeshCacheEntry {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t lodCount;
+};
+
+struct CachedTexture {
+    std::string type;
+    std::string path;
+};
+
+// view of one mesh inside a mapped cache file, the pointers stay valid while the MeshCacheReader is alive
+struct CachedMesh {
+    const Vertex *vertices;
+    uint32_t vertexCount;
+    const unsigned int *indices;
+    uint32_t indexCount;
+    const MeshLod *lods;
+    uint32_t lodCount;
+    std::vector<CachedTexture> textures;
+};
+
+class MeshCacheReader{
+
+    public:
+        // maps the cache file and validates it against the source hash and import flags
+        bool open(const std::string &cachePath, uint64_t sourceHash, uint32_t importFlags){
+            meshes.clear();
+            if(!file.open(cachePath)){
+                return false;
+            }
+
+            const unsigned char *cursor = file.data();
+            const unsigned char *end = file.data() + file.size();
+
+            MeshCacheHeader header;
+            if(!read(cursor, end, &header, sizeof(header))
+                || std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0
+                || header.version != MESH_CACHE_VERSION
+                || header.vertexSize != sizeof(Vertex)
+                || header.sourceHash != sourceHash
+                || header.importFlags != importFlags){
+                return fail();
+            }
+
+            meshes.reserve(header.meshCount);
+            for(uint32_t i = 0; i < header.meshCount; i++){
+                MeshCacheEntry entry;
+                if(!read(cursor, end, &entry, sizeof(entry))){
+                    return fail();
+                }
+
+                CachedMesh mesh;
+                mesh.vertexCount = entry.vertexCount;
+                mesh.indexCount = entry.indexCount;
+                mesh.vertices = reinterpret_cast<const Vertex *>(cursor);
+                if(!skip(cursor, end, sizeof(Vertex) * entry.vertexCount)){
+                    return fail();
+                }
+                mesh.indices = reinterpret_cast<const unsigned int *>(cursor);
+                if(!skip(cursor, end, sizeof(unsigned int) * entry.indexCount)){
+                    return fail();
+                }
+                mesh.lodCount = entry.lodCount;
+                mesh.lods = reinterpret_cast<const MeshLod *>(cursor);
+                if(!skip(cursor, end, sizeof(MeshLod) * entry.lodCount)){
+                    return fail();
+                }
+                for(uint32_t l = 0; l < mesh.lodCount; l++){
+                    if(mesh.lods[l].firstIndex > entry.indexCount || mesh.lods[l].indexCount > entry.indexCount - mesh.lods[l].firstIndex){
+                        return fail();
+                    }
+                }
+
+                for(uint32_t t = 0; t < entry.textureCount; t++){
+                    uint32_t lengths[2];
+                    if(!read(cursor, end, lengths, sizeof(lengths))){
+                        return fail();
+                    }
+                    const char *chars = reinterpret_cast<const char *>(cursor);
+                    if(!skip(cursor, end, padded(lengths[0] + lengths[1]))){
+                        return fail();
+                    }
+                    mesh.textures.push_back({std::string(chars, lengths[0]), std::string(chars + lengths[0], lengths[1])});
+                }
+                meshes.push_back(std::move(mesh));
+            }
+            return true;
+        }
+
+        const std::vector<CachedMesh> &getMeshes() const { return meshes; }
+
+        bool isOpen() const { return file.isOpen(); }
+
+        void close(){
+            meshes.clear();
+            file.close();
+        }
+
+    private:
+        MappedFile file;
+        std::vector<CachedMesh> meshes;
+
+        static std::size_t padded(std::size_t size){
+            return (size + 3) & ~static_cast<std::size_t>(3);
+        }
+
+        static bool read(const unsigned char *&cursor, const unsigned char *end, void *out, std::size_t size){
+            if(static_cast<std::size_t>(end - cursor) < size){
+                return false;
+            }
+            std::memcpy(out, cursor, size);
+            cursor += size;
+            return true;
+        }
+
+        static bool skip(const unsigned char *&cursor, const unsigned char *end, std::size_t size){
+            if(static_cast<std::size_t>(end - cursor) < size){
+                return false;
+            }
+            cursor += size;
+            return true;
+        }
+
+        bool fail(){
+            close();
+            return false;
+        }
+};
+
+// writes the meshes of a freshly imported model, the file is renamed into place only once it is complete
+inline bool writeMeshCache(const std::string &cachePath, uint64_t sourceHash, uint32_t importFlags, const std::vector<Mesh> &meshes){
+
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if(!out){
+        std::cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << tempPath << std::endl;
+        return false;
+    }
+
+    const char zeros[4] = {0, 0, 0, 0};
+
+    MeshCacheHeader header;
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.sourceHash = sourceHash;
+    header.importFlags = importFlags;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for(const Mesh &mesh : meshes){
+        MeshCacheEntry entry;
+        entry.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        entry.textureCount = static_cast<uint32_t>(mesh.textures.size());
+        entry.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        out.write(reinterpret_cast<const char *>(mesh.vertices.data()), sizeof(Vertex) * mesh.vertices.size());
+        out.write(reinterpret_cast<const char *>(mesh.indices.data()), sizeof(unsigned int) * mesh.indices.size());
+        out.write(reinterpret_cast<const char *>(mesh.lods.data()), sizeof(MeshLod) * mesh.lods.size());
+
+        for(const Texture &texture : mesh.textures){
+            uint32_t lengths[2] = {static_cast<uint32_t>(texture.type.size()), static_cast<uint32_t>(texture.path.size())};
+            out.write(reinterpret_cast<const char *>(lengths), sizeof(lengths));
+            out.write(texture.type.data(), texture.type.size());
+            out.write(texture.path.data(), texture.path.size());
+            out.write(zeros, (4 - (lengths[0] + lengths[1]) % 4) % 4);
+        }
+    }
+
+    out.close();
+    if(!out || std::rename(tempPath.c_str(), cachePath.c_str()) != 0){
+        std::cout << "ERROR::MESH_CACHE::CANNOT_WRITE " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif //!_MESH_CACHE_HPP
@@ -0,0 +1,391 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <glm/glm.hpp>
+
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Reorders the vertices and triangles of an imported mesh for the GPU, without changing what is drawn:
+//   1. weld      identical vertices become one, so the index buffer can actually share them
+//   2. tipsify   triangle order for the post-transform vertex cache (Sander et al., "Fast Triangle
+//                Reordering for Vertex Locality and Reduced Overdraw", 2007)
+//   3. overdraw  the clusters tipsify cut at its dead ends are split further where the cache allows, then
+//                sorted to draw outward facing ones first
+//   4. fetch     vertices renumbered in the order the index buffer first uses them
+// ACMR (cache misses per triangle) and ATVR (cache misses per vertex, 1.0 is ideal) are measured with
+// a FIFO cache of VERTEX_CACHE_SIZE entries before and after.
+
+// entries of the simulated post-transform cache, and the cache size tipsify optimizes for
+constexpr int VERTEX_CACHE_SIZE{16};
+
+// the paper's lambda: a cluster is split once a piece drawn from a cold cache reaches this many times
+// the ACMR of the whole cluster. Higher gives the overdraw sort smaller pieces, at some cache cost.
+constexpr double OVERDRAW_CLUSTER_ACMR{1.05};
+
+struct MeshOptimizationStats {
+    size_t triangles{0};
+    size_t verticesBefore{0};
+    size_t verticesAfter{0};
+    size_t missesBefore{0};
+    size_t missesAfter{0};
+
+    void add(const MeshOptimizationStats &other){
+        triangles += other.triangles;
+        verticesBefore += other.verticesBefore;
+        verticesAfter += other.verticesAfter;
+        missesBefore += other.missesBefore;
+        missesAfter += other.missesAfter;
+    }
+
+    double acmrBefore() const { return triangles ? static_cast<double>(missesBefore) / triangles : 0.0; }
+    double acmrAfter() const { return triangles ? static_cast<double>(missesAfter) / triangles : 0.0; }
+    double atvrBefore() const { return verticesBefore ? static_cast<double>(missesBefore) / verticesBefore : 0.0; }
+    double atvrAfter() const { return verticesAfter ? static_cast<double>(missesAfter) / verticesAfter : 0.0; }
+};
+
+namespace meshopt {
+
+    // transforms a FIFO cache of cacheSize entries would do for this index order
+    inline size_t cacheMisses(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize){
+        // a vertex is in the cache if it was inserted less than cacheSize insertions ago
+        std::vector<size_t> insertedAt(vertexCount, 0);
+        size_t insertions = 0;
+        for(unsigned int index : indices)
+        {
+            if(insertedAt[index] == 0 || insertions - insertedAt[index] >= static_cast<size_t>(cacheSize))
+            {
+                insertions++;
+                insertedAt[index] = insertions;
+            }
+        }
+        return insertions;
+    }
+
+    // the attributes of a vertex that reach the GPU, the bone fields aren't always initialized
+    inline bool sameVertex(const Vertex &a, const Vertex &b){
+        return a.Position == b.Position && a.Normal == b.Normal && a.TexCoords == b.TexCoords
+            && a.Tangent == b.Tangent && a.Bitangent == b.Bitangent;
+    }
+
+    struct VertexHash {
+        size_t operator()(const Vertex &vertex) const{
+            const float fields[] = {vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.Normal.x, vertex.Normal.y, vertex.Normal.z, vertex.TexCoords.x, vertex.TexCoords.y};
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for(float field : fields)
+            {
+                // +0.0 and -0.0 compare equal, so they must hash the same
+                if(field == 0.0f)
+                    field = 0.0f;
+                uint32_t bits;
+                std::memcpy(&bits, &field, sizeof(bits));
+                hash = (hash ^ bits) * 0x100000001b3ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct VertexEqual {
+        bool operator()(const Vertex &a, const Vertex &b) const{
+            return sameVertex(a, b);
+        }
+    };
+
+    // merges identical vertices, the indices are remapped to the first occurrence
+    inline void weld(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices){
+        std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+        unique.reserve(vertices.size());
+        std::vector<unsigned int> remap(vertices.size());
+        std::vector<Vertex> welded;
+        welded.reserve(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++)
+        {
+            auto found = unique.emplace(vertices[i], static_cast<unsigned int>(welded.size()));
+            if(found.second)
+                welded.push_back(vertices[i]);
+            remap[i] = found.first->second;
+        }
+        for(unsigned int &index : indices)
+            index = remap[index];
+        vertices.swap(welded);
+    }
+
+    // tipsify: fans around the most recently cached vertex whose remaining triangles still fit in the
+    // cache, jumps back to the last dead-end vertices otherwise. Returns the triangle order and the
+    // triangle positions where a jump broke the locality, the cluster boundaries of the overdraw pass.
+    inline void tipsify(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize, std::vector<unsigned int> &order, std::vector<size_t> &clusterStarts){
+        size_t triangleCount = indices.size() / 3;
+
+        // vertex -> triangles adjacency
+        std::vector<unsigned int> liveTriangles(vertexCount, 0);
+        for(unsigned int index : indices)
+            liveTriangles[index]++;
+        std::vector<size_t> offsets(vertexCount + 1, 0);
+        for(size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + liveTriangles[v];
+        std::vector<unsigned int> adjacency(indices.size());
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            for(int corner = 0; corner < 3; corner++)
+                adjacency[fill[indices[t * 3 + corner]]++] = static_cast<unsigned int>(t);
+        }
+
+        std::vector<size_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<unsigned int> deadEnds;
+        std::vector<unsigned int> candidates;
+        order.clear();
+        order.reserve(triangleCount);
+        clusterStarts.clear();
+
+        size_t time = static_cast<size_t>(cacheSize) + 1;
+        // start at the first vertex with triangles, index lists of a level of detail leave many unused
+        size_t cursor = 0;
+        while(cursor < vertexCount && liveTriangles[cursor] == 0)
+            cursor++;
+        long fanning = cursor < vertexCount ? static_cast<long>(cursor) : -1;
+        bool jumped = true;
+        while(fanning >= 0)
+        {
+            if(jumped)
+                clusterStarts.push_back(order.size());
+
+            candidates.clear();
+            for(size_t a = offsets[fanning]; a < offsets[fanning + 1]; a++)
+            {
+                unsigned int t = adjacency[a];
+                if(emitted[t])
+                    continue;
+                emitted[t] = true;
+                order.push_back(t);
+                for(int corner = 0; corner < 3; corner++)
+                {
+                    unsigned int v = indices[t * 3 + corner];
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    liveTriangles[v]--;
+                    if(time - cacheTime[v] > static_cast<size_t>(cacheSize))
+                        cacheTime[v] = time++;
+                }
+            }
+
+            // the candidate that is still cached after fanning all its remaining triangles, the oldest first
+            long best = -1;
+            long bestPriority = -1;
+            for(unsigned int v : candidates)
+            {
+                if(liveTriangles[v] == 0)
+                    continue;
+                long priority = 0;
+                if(time - cacheTime[v] + 2 * liveTriangles[v] <= static_cast<size_t>(cacheSize))
+                    priority = static_cast<long>(time - cacheTime[v]);
+                if(priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    best = v;
+                }
+            }
+
+            jumped = best < 0;
+            if(jumped)
+            {
+                while(!deadEnds.empty() && best < 0)
+                {
+                    unsigned int v = deadEnds.back();
+                    deadEnds.pop_back();
+                    if(liveTriangles[v] > 0)
+                        best = v;
+                }
+                while(cursor < vertexCount && best < 0)
+                {
+                    if(liveTriangles[cursor] > 0)
+                        best = static_cast<long>(cursor);
+                    cursor++;
+                }
+            }
+            fanning = best;
+        }
+        // a jump that found nothing left to draw doesn't start a cluster
+        while(!clusterStarts.empty() && clusterStarts.back() >= order.size())
+            clusterStarts.pop_back();
+    }
+
+    // splits the dead-end clusters of tipsify into the pieces the overdraw sort may reorder freely: each
+    // piece is simulated from a cold cache and ends as soon as its ACMR is within threshold times the
+    // cold-cache ACMR of its whole cluster, so drawing the pieces in any order costs little locality
+    inline void splitClusters(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize, double threshold, const std::vector<unsigned int> &order, std::vector<size_t> &clusterStarts){
+        std::vector<size_t> cacheTime(vertexCount, 0);
+        size_t time = static_cast<size_t>(cacheSize) + 1;
+        // forgets every cached vertex
+        auto flush = [&](){ time += static_cast<size_t>(cacheSize) + 1; };
+        auto triangleMisses = [&](unsigned int t){
+            size_t misses = 0;
+            for(int corner = 0; corner < 3; corner++)
+            {
+                unsigned int v = indices[t * 3 + corner];
+                if(time - cacheTime[v] > static_cast<size_t>(cacheSize))
+                {
+                    cacheTime[v] = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        };
+
+        std::vector<size_t> split;
+        split.reserve(clusterStarts.size());
+        for(size_t c = 0; c < clusterStarts.size(); c++)
+        {
+            size_t begin = clusterStarts[c];
+            size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : order.size();
+            if(begin == end)
+                continue;
+
+            flush();
+            size_t clusterMisses = 0;
+            for(size_t o = begin; o < end; o++)
+                clusterMisses += triangleMisses(order[o]);
+            double target = threshold * static_cast<double>(clusterMisses) / static_cast<double>(end - begin);
+
+            split.push_back(begin);
+            flush();
+            size_t misses = 0;
+            size_t triangles = 0;
+            for(size_t o = begin; o + 1 < end; o++)
+            {
+                misses += triangleMisses(order[o]);
+                triangles++;
+                if(static_cast<double>(misses) <= target * static_cast<double>(triangles))
+                {
+                    split.push_back(o + 1);
+                    flush();
+                    misses = 0;
+                    triangles = 0;
+                }
+            }
+        }
+        clusterStarts.swap(split);
+    }
+
+    // sorts the clusters so the ones facing away from the mesh center are drawn first: they tend to
+    // occlude the others, which then fail the depth test instead of being shaded and overwritten
+    inline void sortClustersForOverdraw(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<unsigned int> &order, const std::vector<size_t> &clusterStarts, std::vector<unsigned int> &sorted){
+        struct Cluster {
+            size_t begin;
+            size_t end;
+            float facing;
+        };
+
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        std::vector<Cluster> clusters;
+        std::vector<glm::vec3> clusterCenters;
+        std::vector<glm::vec3> clusterNormals;
+        for(size_t c = 0; c < clusterStarts.size(); c++)
+        {
+            size_t begin = clusterStarts[c];
+            size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : order.size();
+            glm::vec3 center(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0.0f;
+            for(size_t o = begin; o < end; o++)
+            {
+                const unsigned int *triangle = &indices[order[o] * 3];
+                const glm::vec3 &a = vertices[triangle[0]].Position;
+                const glm::vec3 &b = vertices[triangle[1]].Position;
+                const glm::vec3 &d = vertices[triangle[2]].Position;
+                glm::vec3 cross = glm::cross(b - a, d - a);
+                float triangleArea = std::sqrt(glm::dot(cross, cross)) * 0.5f;
+                center += (a + b + d) * (triangleArea / 3.0f);
+                normal += cross;
+                area += triangleArea;
+            }
+            meshCenter += center;
+            meshArea += area;
+            clusters.push_back({begin, end, 0.0f});
+            clusterCenters.push_back(area > 0.0f ? center * (1.0f / area) : vertices[indices[order[begin] * 3]].Position);
+            clusterNormals.push_back(normal);
+        }
+        if(meshArea > 0.0f)
+            meshCenter = meshCenter * (1.0f / meshArea);
+
+        for(size_t c = 0; c < clusters.size(); c++)
+        {
+            float length = std::sqrt(glm::dot(clusterNormals[c], clusterNormals[c]));
+            clusters[c].facing = length > 0.0f ? glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c]) / length : 0.0f;
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b){
+            return a.facing > b.facing;
+        });
+
+        sorted.clear();
+        sorted.reserve(indices.size());
+        for(const Cluster &cluster : clusters)
+        {
+            for(size_t o = cluster.begin; o < cluster.end; o++)
+            {
+                const unsigned int *triangle = &indices[order[o] * 3];
+                sorted.insert(sorted.end(), triangle, triangle + 3);
+            }
+        }
+    }
+
+    // renumbers the vertices in the order the indices first reference them, unused ones are dropped
+    inline void optimizeFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices){
+        constexpr unsigned int UNUSED = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), UNUSED);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+        for(unsigned int &index : indices)
+        {
+            if(remap[index] == UNUSED)
+            {
+                remap[index] = static_cast<unsigned int>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(reordered);
+    }
+}
+
+// runs every pass on a triangle list and returns its cache statistics
+inline MeshOptimizationStats optimizeMesh(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    MeshOptimizationStats stats;
+    stats.triangles = indices.size() / 3;
+    stats.verticesBefore = vertices.size();
+    stats.missesBefore = meshopt::cacheMisses(indices, vertices.size(), VERTEX_CACHE_SIZE);
+    if(indices.size() < 3 || indices.size() % 3 != 0)
+    {
+        stats.verticesAfter = stats.verticesBefore;
+        stats.missesAfter = stats.missesBefore;
+        return stats;
+    }
+
+    meshopt::weld(vertices, indices);
+
+    std::vector<unsigned int> order;
+    std::vector<size_t> clusterStarts;
+    meshopt::tipsify(indices, vertices.size(), VERTEX_CACHE_SIZE, order, clusterStarts);
+    meshopt::splitClusters(indices, vertices.size(), VERTEX_CACHE_SIZE, OVERDRAW_CLUSTER_ACMR, order, clusterStarts);
+
+    std::vector<unsigned int> sorted;
+    meshopt::sortClustersForOverdraw(vertices, indices, order, clusterStarts, sorted);
+    indices.swap(sorted);
+
+    meshopt::optimizeFetch(vertices, indices);
+
+    stats.verticesAfter = vertices.size();
+    stats.missesAfter = meshopt::cacheMisses(indices, vertices.size(), VERTEX_CACHE_SIZE);
+    return stats;
+}
+
+#endif //!_MESH_OPTIMIZER_HPP
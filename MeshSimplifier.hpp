@@ -0,0 +1,451 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Levels of detail of an imported mesh, built with quadric error metric edge collapses (Garland and
+// Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997). A vertex is only ever
+// collapsed onto one of its neighbours, so every level indexes the mesh's own vertices and is just
+// one more range of its index buffer. The topology constrains the collapses: a border vertex only
+// slides along its border, a vertex split by a UV or normal seam only along the seam (each copy
+// moving onto the matching copy of the target), and vertices where the surface is anything more
+// complicated stay put.
+
+// meshes with fewer triangles keep their single level
+constexpr size_t LOD_MIN_TRIANGLES{64};
+// largest error a level may reach, relative to the diagonal of the mesh's bounding box
+constexpr float LOD_MAX_ERROR{0.05f};
+// a level is only kept when it drops at least this fraction of the previous level's triangles
+constexpr float LOD_MIN_REDUCTION{0.2f};
+// weight of the planes that hold borders and seams in place, relative to the surface
+constexpr double LOD_BORDER_WEIGHT{10.0};
+
+namespace meshsimplify {
+
+    // weighted sum of squared distances to a set of planes, x'Ax + 2b'x + c
+    struct Quadric {
+        double a00{0.0}, a01{0.0}, a02{0.0}, a11{0.0}, a12{0.0}, a22{0.0};
+        double b0{0.0}, b1{0.0}, b2{0.0};
+        double c{0.0};
+        double weight{0.0};
+
+        // plane n.x + d = 0, n of unit length
+        void addPlane(const glm::vec3 &n, double d, double w){
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric &other){
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // mean squared distance from a point to the planes
+        double error(const glm::vec3 &p) const{
+            if(weight <= 0.0)
+                return 0.0;
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                     + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return std::max(e, 0.0) / weight;
+        }
+    };
+
+    enum class VertexKind : uint8_t {
+        Manifold,   // inside the surface, collapses onto any neighbour
+        Border,     // on an open edge loop, collapses along it
+        Seam,       // split into copies by the attributes, collapses along the split
+        Locked      // corners, junctions and non-manifold vertices
+    };
+
+    // vertices at the same position, the copies of a seam, share the first of them as their representative
+    inline void findPositionRepresentatives(const std::vector<Vertex> &vertices, std::vector<unsigned int> &representative){
+        struct PositionHash {
+            size_t operator()(const glm::vec3 &position) const{
+                uint64_t hash = 0xcbf29ce484222325ull;
+                for(int i = 0; i < 3; i++)
+                {
+                    float field = position[i] == 0.0f ? 0.0f : position[i];
+                    uint32_t bits;
+                    std::memcpy(&bits, &field, sizeof(bits));
+                    hash = (hash ^ bits) * 0x100000001b3ull;
+                }
+                return static_cast<size_t>(hash);
+            }
+        };
+        std::unordered_map<glm::vec3, unsigned int, PositionHash> first;
+        first.reserve(vertices.size());
+        representative.resize(vertices.size());
+        for(size_t v = 0; v < vertices.size(); v++)
+            representative[v] = first.emplace(vertices[v].Position, static_cast<unsigned int>(v)).first->second;
+    }
+
+    // triangles around each position representative
+    struct Adjacency {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        void build(const std::vector<unsigned int> &indices, const std::vector<unsigned int> &representative){
+            offsets.assign(representative.size() + 1, 0);
+            for(unsigned int index : indices)
+                offsets[representative[index] + 1]++;
+            for(size_t v = 0; v < representative.size(); v++)
+                offsets[v + 1] += offsets[v];
+            triangles.resize(indices.size());
+            std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+            for(size_t i = 0; i < indices.size(); i++)
+                triangles[fill[representative[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+        }
+    };
+
+    inline glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c){
+        return glm::cross(b - a, c - a);
+    }
+
+    // classifies every position and seeds its quadric with the planes of its triangles, plus planes
+    // perpendicular to its border and seam edges that resist moving them
+    inline void classify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<unsigned int> &representative,
+                         const Adjacency &adjacency, std::vector<VertexKind> &kinds, std::vector<Quadric> &quadrics){
+        struct Edge {
+            unsigned int other;        // representative at the far end
+            unsigned int copy;         // vertex used at this end
+            unsigned int otherCopy;    // vertex used at the far end
+            unsigned int triangle;
+        };
+
+        size_t count = representative.size();
+        kinds.assign(count, VertexKind::Manifold);
+        quadrics.assign(count, Quadric{});
+
+        std::vector<Edge> edges;
+        std::vector<unsigned int> copies;
+        for(size_t v = 0; v < count; v++)
+        {
+            if(representative[v] != v)
+                continue;
+
+            edges.clear();
+            copies.clear();
+            for(unsigned int a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; a++)
+            {
+                unsigned int t = adjacency.triangles[a];
+                const unsigned int *triangle = &indices[t * 3];
+                int corner = representative[triangle[0]] == v ? 0 : representative[triangle[1]] == v ? 1 : 2;
+                for(int step = 1; step < 3; step++)
+                {
+                    unsigned int other = triangle[(corner + step) % 3];
+                    edges.push_back({representative[other], triangle[corner], other, t});
+                }
+                copies.push_back(triangle[corner]);
+
+                const glm::vec3 &p0 = vertices[triangle[0]].Position;
+                const glm::vec3 &p1 = vertices[triangle[1]].Position;
+                const glm::vec3 &p2 = vertices[triangle[2]].Position;
+                glm::vec3 normal = triangleNormal(p0, p1, p2);
+                float length = glm::length(normal);
+                if(length > 0.0f)
+                {
+                    normal = normal / length;
+                    quadrics[v].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+                }
+            }
+            std::sort(copies.begin(), copies.end());
+            size_t copyCount = std::unique(copies.begin(), copies.end()) - copies.begin();
+
+            std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b){
+                return a.other < b.other;
+            });
+            int borderEdges = 0;
+            int seamEdges = 0;
+            bool complex = false;
+            for(size_t begin = 0; begin < edges.size();)
+            {
+                size_t end = begin + 1;
+                while(end < edges.size() && edges[end].other == edges[begin].other)
+                    end++;
+
+                size_t shared = end - begin;
+                bool border = shared == 1;
+                bool seam = shared == 2 && (edges[begin].copy != edges[begin + 1].copy || edges[begin].otherCopy != edges[begin + 1].otherCopy);
+                if(shared > 2)
+                    complex = true;
+                if(border)
+                    borderEdges++;
+                if(seam)
+                    seamEdges++;
+
+                if(border || seam)
+                {
+                    const unsigned int *triangle = &indices[edges[begin].triangle * 3];
+                    glm::vec3 faceNormal = triangleNormal(vertices[triangle[0]].Position, vertices[triangle[1]].Position, vertices[triangle[2]].Position);
+                    const glm::vec3 &from = vertices[v].Position;
+                    glm::vec3 edge = vertices[edges[begin].other].Position - from;
+                    glm::vec3 normal = glm::cross(edge, faceNormal);
+                    float length = glm::length(normal);
+                    if(length > 0.0f)
+                    {
+                        normal = normal / length;
+                        quadrics[v].addPlane(normal, -glm::dot(normal, from), glm::dot(edge, edge) * LOD_BORDER_WEIGHT);
+                    }
+                }
+                begin = end;
+            }
+
+            if(complex)
+                kinds[v] = VertexKind::Locked;
+            else if(borderEdges > 0)
+                kinds[v] = borderEdges == 2 && seamEdges == 0 && copyCount == 1 ? VertexKind::Border : VertexKind::Locked;
+            else if(copyCount > 1)
+                kinds[v] = seamEdges == 2 ? VertexKind::Seam : VertexKind::Locked;
+        }
+    }
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    // checks that the from -> to collapse keeps the topology and doesn't fold any triangle over, and
+    // finds the copy of `to` each copy of `from` moves onto. Returns the number of triangles it
+    // removes, 0 if it isn't allowed.
+    inline size_t checkCollapse(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::vector<unsigned int> &representative,
+                                const Adjacency &adjacency, VertexKind kind, unsigned int from, unsigned int to, std::vector<std::pair<unsigned int, unsigned int>> &moves){
+        if(kind == VertexKind::Locked)
+            return 0;
+
+        // the triangles on the collapsed edge pair each copy of the vertex with a copy of the target
+        moves.clear();
+        size_t shared = 0;
+        for(unsigned int a = adjacency.offsets[from]; a < adjacency.offsets[from + 1]; a++)
+        {
+            const unsigned int *triangle = &indices[adjacency.triangles[a] * 3];
+            unsigned int copy = ~0u;
+            unsigned int partner = ~0u;
+            for(int corner = 0; corner < 3; corner++)
+            {
+                if(representative[triangle[corner]] == from)
+                    copy = triangle[corner];
+                else if(representative[triangle[corner]] == to)
+                    partner = triangle[corner];
+            }
+            if(partner == ~0u)
+                continue;
+
+            shared++;
+            auto move = std::find_if(moves.begin(), moves.end(), [copy](const std::pair<unsigned int, unsigned int> &m){ return m.first == copy; });
+            if(move == moves.end())
+                moves.push_back({copy, partner});
+            else if(move->second != partner)
+                return 0;
+        }
+        // a border vertex only moves along its border
+        if(shared == 0 || (kind == VertexKind::Border && shared != 1))
+            return 0;
+
+        // the other triangles stay: their copy needs somewhere to go and they must keep facing the same way
+        const glm::vec3 &target = vertices[to].Position;
+        for(unsigned int a = adjacency.offsets[from]; a < adjacency.offsets[from + 1]; a++)
+        {
+            const unsigned int *triangle = &indices[adjacency.triangles[a] * 3];
+            int corner = representative[triangle[0]] == from ? 0 : representative[triangle[1]] == from ? 1 : 2;
+            if(representative[triangle[(corner + 1) % 3]] == to || representative[triangle[(corner + 2) % 3]] == to)
+                continue;
+
+            unsigned int copy = triangle[corner];
+            if(std::none_of(moves.begin(), moves.end(), [copy](const std::pair<unsigned int, unsigned int> &m){ return m.first == copy; }))
+                return 0;
+
+            const glm::vec3 &p0 = vertices[triangle[0]].Position;
+            const glm::vec3 &p1 = vertices[triangle[1]].Position;
+            const glm::vec3 &p2 = vertices[triangle[2]].Position;
+            glm::vec3 before = triangleNormal(p0, p1, p2);
+            glm::vec3 after = triangleNormal(corner == 0 ? target : p0, corner == 1 ? target : p1, corner == 2 ? target : p2);
+            if(glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+                return 0;
+        }
+        return shared;
+    }
+
+    // simplifies a triangle list towards targetIndexCount indices without going over errorLimit, writing
+    // the result into `result`. Returns the error reached, in model units.
+    inline float simplify(const std::vector<Vertex> &vertices, const unsigned int *source, size_t indexCount, size_t targetIndexCount, float errorLimit, std::vector<unsigned int> &result){
+        result.assign(source, source + indexCount);
+        if(indexCount < 3 || vertices.empty())
+            return 0.0f;
+
+        std::vector<unsigned int> representative;
+        findPositionRepresentatives(vertices, representative);
+
+        Adjacency adjacency;
+        adjacency.build(result, representative);
+        std::vector<VertexKind> kinds;
+        std::vector<Quadric> quadrics;
+        classify(vertices, result, representative, adjacency, kinds, quadrics);
+
+        double limit = static_cast<double>(errorLimit) * errorLimit;
+        double reached = 0.0;
+        size_t triangleCount = indexCount / 3;
+        size_t targetTriangles = targetIndexCount / 3;
+
+        std::vector<Collapse> candidates;
+        std::vector<unsigned int> remap(vertices.size());
+        std::vector<bool> touched(vertices.size());
+        std::vector<std::pair<unsigned int, unsigned int>> moves;
+        while(triangleCount > targetTriangles)
+        {
+            // every edge both ways, cheapest first
+            candidates.clear();
+            for(size_t i = 0; i < result.size(); i++)
+            {
+                unsigned int from = representative[result[i]];
+                unsigned int to = representative[result[i - i % 3 + (i % 3 + 1) % 3]];
+                if(kinds[from] != VertexKind::Locked)
+                    candidates.push_back({from, to, quadrics[from].error(vertices[to].Position)});
+                if(kinds[to] != VertexKind::Locked)
+                    candidates.push_back({to, from, quadrics[to].error(vertices[from].Position)});
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse &a, const Collapse &b){
+                return a.cost < b.cost;
+            });
+
+            // collapses whose neighbourhoods don't overlap, so the adjacency stays valid for all of them
+            for(size_t v = 0; v < remap.size(); v++)
+                remap[v] = static_cast<unsigned int>(v);
+            std::fill(touched.begin(), touched.end(), false);
+            size_t collapsed = 0;
+            for(const Collapse &collapse : candidates)
+            {
+                if(triangleCount <= targetTriangles || collapse.cost > limit)
+                    break;
+                if(touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                size_t removed = checkCollapse(vertices, result, representative, adjacency, kinds[collapse.from], collapse.from, collapse.to, moves);
+                if(removed == 0)
+                    continue;
+
+                for(const auto &move : moves)
+                    remap[move.first] = move.second;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                triangleCount -= removed;
+                reached = std::max(reached, collapse.cost);
+                collapsed++;
+
+                touched[collapse.to] = true;
+                for(unsigned int a = adjacency.offsets[collapse.from]; a < adjacency.offsets[collapse.from + 1]; a++)
+                {
+                    const unsigned int *triangle = &result[adjacency.triangles[a] * 3];
+                    for(int corner = 0; corner < 3; corner++)
+                        touched[representative[triangle[corner]]] = true;
+                }
+            }
+            if(collapsed == 0)
+                break;
+
+            // apply the pass, dropping the triangles that lost an edge
+            size_t kept = 0;
+            for(size_t i = 0; i < result.size(); i += 3)
+            {
+                unsigned int a = remap[result[i]];
+                unsigned int b = remap[result[i + 1]];
+                unsigned int c = remap[result[i + 2]];
+                unsigned int ra = representative[a], rb = representative[b], rc = representative[c];
+                if(ra == rb || rb == rc || ra == rc)
+                    continue;
+                result[kept++] = a;
+                result[kept++] = b;
+                result[kept++] = c;
+            }
+            result.resize(kept);
+            triangleCount = kept / 3;
+            adjacency.build(result, representative);
+        }
+        return static_cast<float>(std::sqrt(reached));
+    }
+}
+
+// triangles of each level of detail of a mesh, summed over the meshes of a model
+struct MeshLodStats {
+    size_t levels{1};
+    size_t triangles[MAX_MESH_LODS] = {};
+
+    void add(const MeshLodStats &other){
+        levels = std::max(levels, other.levels);
+        for(size_t level = 0; level < MAX_MESH_LODS; level++)
+            triangles[level] += other.triangles[level];
+    }
+};
+
+// appends the coarser levels of detail of a mesh to its index buffer, each one reordered for the vertex
+// cache and overdraw like the full level, and describes every level in lods. The vertices are left as they are.
+inline MeshLodStats generateLods(const std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, std::vector<MeshLod> &lods)
+{
+    size_t fullCount = indices.size();
+    lods.assign(1, MeshLod{0, static_cast<uint32_t>(fullCount), 0.0f});
+
+    MeshLodStats stats;
+    for(size_t level = 0; level < MAX_MESH_LODS; level++)
+        stats.triangles[level] = fullCount / 3;
+    if(fullCount / 3 < LOD_MIN_TRIANGLES * 2 || fullCount % 3 != 0)
+        return stats;
+
+    glm::vec3 low = vertices[indices[0]].Position;
+    glm::vec3 high = low;
+    for(unsigned int index : indices)
+    {
+        low = glm::min(low, vertices[index].Position);
+        high = glm::max(high, vertices[index].Position);
+    }
+    float errorLimit = LOD_MAX_ERROR * glm::length(high - low);
+
+    std::vector<unsigned int> simplified;
+    std::vector<unsigned int> order;
+    std::vector<size_t> clusterStarts;
+    std::vector<unsigned int> sorted;
+    for(size_t level = 1; level < MAX_MESH_LODS; level++)
+    {
+        size_t targetTriangles = (fullCount / 3) >> level;
+        if(targetTriangles < LOD_MIN_TRIANGLES)
+            break;
+
+        // every level starts from the full mesh, so its error is measured against what it replaces
+        float error = meshsimplify::simplify(vertices, indices.data(), fullCount, targetTriangles * 3, errorLimit, simplified);
+        const MeshLod &previous = lods.back();
+        if(simplified.empty() || simplified.size() > previous.indexCount * (1.0f - LOD_MIN_REDUCTION))
+            break;
+
+        meshopt::tipsify(simplified, vertices.size(), VERTEX_CACHE_SIZE, order, clusterStarts);
+        meshopt::splitClusters(simplified, vertices.size(), VERTEX_CACHE_SIZE, OVERDRAW_CLUSTER_ACMR, order, clusterStarts);
+        meshopt::sortClustersForOverdraw(vertices, simplified, order, clusterStarts, sorted);
+
+        MeshLod lod{static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(sorted.size()), std::max(error, previous.error)};
+        indices.insert(indices.end(), sorted.begin(), sorted.end());
+        lods.push_back(lod);
+    }
+
+    stats.levels = lods.size();
+    for(size_t level = 0; level < MAX_MESH_LODS; level++)
+        stats.triangles[level] = lods[std::min(level, lods.size() - 1)].indexCount / 3;
+    return stats;
+}
+
+#endif //!_MESH_SIMPLIFIER_HPP
@@ -14,45 +14,177 @@
 
 #include "Shader.hpp"
 #include "Mesh.hpp"
-
+#include "GeometryBuffer.hpp"
+#include "ShaderVariants.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "ObjLoader.hpp"
+#include "TextureLoader.hpp"
+#include "TextureCache.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+#include <memory>
 #include <string>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
+// post-processing applied by Assimp, part of the mesh cache key
+constexpr unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace;
+// mesh cache key of the models read by the native .obj importer, which doesn't produce the same vertices
+constexpr unsigned int MODEL_IMPORT_NATIVE_OBJ = 1u << 31;
+// mesh cache key bit of the meshes that went through optimizeMesh
+constexpr unsigned int MODEL_IMPORT_OPTIMIZED = 1u << 30;
+
+// which importer reads a model file
+enum class ModelImporter {
+    Auto,     // the native one for .obj files, Assimp for everything else
+    Native,   // ObjLoader.hpp, .obj only
+    Assimp
+};
+
+// converts the vertices and faces of an Assimp mesh
+inline void readAssimpGeometry(const aiMesh *mesh, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices){
+    // sized up front, the faces are triangles after aiProcess_Triangulate
+    vertices.reserve(vertices.size() + mesh->mNumVertices);
+    indices.reserve(indices.size() + static_cast<size_t>(mesh->mNumFaces) * 3);
+    // walk through each of the mesh's vertices
+    for(unsigned int i = 0; i < mesh->mNumVertices; i++){
+        // zeroed, meshes without uvs leave the tangent space unset and weld compares it
+        Vertex vertex{};
+        glm::vec3 vector;// we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+        //positions
+        vector.x = mesh->mVertices[i].x;
+        vector.y = mesh->mVertices[i].y;
+        vector.z = mesh->mVertices[i].z;
+        vertex.Position = vector;
+        //normals
+        if(mesh->HasNormals()){
+            vector.x = mesh->mNormals[i].x;
+            vector.y = mesh->mNormals[i].y;
+            vector.z = mesh->mNormals[i].z;
+            vertex.Normal = vector;
+        }
+        //texture coordinates
+        if(mesh->mTextureCoords[0]) //does the mesh contain texture coordinates?
+        {
+            glm::vec2 vec;
+            // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
+            // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+            vec.x = mesh->mTextureCoords[0][i].x;
+            vec.y = mesh->mTextureCoords[0][i].y;
+            vertex.TexCoords = vec;
+            //tangent
+            vector.x = mesh->mTangents[i].x;
+            vector.y = mesh->mTangents[i].y;
+            vector.z = mesh->mTangents[i].z;
+            vertex.Tangent = vector;
+            //bitangent
+            vector.x = mesh->mBitangents[i].x;
+            vector.y = mesh->mBitangents[i].y;
+            vector.z = mesh->mBitangents[i].x;
+            vertex.Bitangent = vector;
+        } else {
+            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+        }
+        vertices.push_back(vertex);
+    }
+
+    // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+    for(unsigned int i = 0; i < mesh->mNumFaces; i++){
+        const aiFace &face = mesh->mFaces[i];
+        //retrieve all indices of the face and store them in the indices vector
+        for(unsigned int j = 0; j < face.mNumIndices; j++){
+            indices.push_back(face.mIndices[j]);
+        }
+    }
+}
 
+// tag of the Model constructor that leaves the loading to prepare() and upload(), see ModelLoader
+struct DeferredModelLoad {};
+
+// A model is loaded in two stages: prepare() does the CPU side (mesh cache, .obj or Assimp import,
+// texture mapping/baking) and can run on any thread, upload() creates the GL objects on the context thread.
+// Until then the model draws nothing.
 class Model{
 
     public:
         //model data
         std::vector<Texture> textures_loaded;
         std::vector<Mesh> meshes;
+        // vertex/index buffers shared by all the meshes
+        GeometryBuffer geometry;
         std::string directory;
         bool gammaCorrection;
-
-        //constructor
-        Model(std::string const &path, bool gamma = false) : gammaCorrection(gamma){
-            loadModel(path);
+        // textures are flipped vertically on load, matching the UVs exported by Blender
+        bool flipTextures;
+        // the meshes keep their vertices and indices after upload, otherwise only the GL buffers hold them
+        bool keepGeometry;
+
+        //constructor, loads the model right away on the calling (GL) thread
+        Model(std::string const &path, bool gamma = false, bool flip = true, ModelImporter importer = ModelImporter::Auto, bool keep = true) : gammaCorrection(gamma), flipTextures(flip), keepGeometry(keep), modelImporter(importer), ready(false), instances(nullptr){
+            MipChainRequests requests;
+            prepare(path, requests);
+            upload();
         }
 
-        // draws the model, and thus all its meshes
-        void Draw(Shader &shader){
-            for(unsigned int i = 0; i < meshes.size(); i++){
-                meshes[i].Draw(shader);
+        // empty model, filled in by prepare() and upload()
+        explicit Model(DeferredModelLoad, bool gamma = false, bool flip = true, ModelImporter importer = ModelImporter::Auto, bool keep = true) : gammaCorrection(gamma), flipTextures(flip), keepGeometry(keep), modelImporter(importer), ready(false), instances(nullptr){}
+
+        // the textures are shared through the TextureCache, give back this model's references
+        ~Model(){
+            for(const Texture &texture : textures_loaded){
+                TextureCache::instance().release(texture.id);
             }
         }
 
-    private:
-        // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-        void loadModel(std::string const &path){
-            //read file via ASSIMP
-            Assimp::Importer importer;
-            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
-            //check for errors
-            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode){
-                std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-                return;
+        Model(const Model &) = delete;
+        Model &operator=(const Model &) = delete;
+
+        // draws the model, and thus all its meshes, with one multi-draw per material
+        void Draw(Shader &shader, size_t lod = 0){
+            geometry.Draw(shader, lod);
+        }
+
+        // same, with the model shader variant each material needs for the scene's features
+        void Draw(ShaderVariants &variants, uint32_t sceneFeatures, const ObjectUniforms &object, size_t lod = 0){
+            geometry.Draw(variants, sceneFeatures, object, lod);
+        }
+
+        // makes the per-instance data of a clock wall available to DrawInstanced, once uploaded
+        void attachInstances(ClockInstances &clockInstances){
+            instances = &clockInstances;
+            if(ready){
+                geometry.attachInstances(clockInstances);
             }
+        }
+
+        // draws the model once per clock of a wall, see ClockInstances
+        void DrawInstanced(ShaderVariants &variants, uint32_t sceneFeatures, ClockPart part, float shininess, size_t instanceCount, size_t lod = 0){
+            geometry.DrawInstanced(variants, sceneFeatures, part, shininess, static_cast<GLsizei>(instanceCount), lod);
+        }
+
+        // level of detail to draw the model with at pixelsPerUnit screen pixels per model unit, see
+        // BasicGeometryBuffer::selectLod; 0 until uploaded
+        size_t selectLod(float pixelsPerUnit) const { return geometry.selectLod(pixelsPerUnit); }
+
+        // bounding sphere in model space
+        const glm::vec3 &getBoundsCenter() const { return geometry.getBoundsCenter(); }
+        float getBoundsRadius() const { return geometry.getBoundsRadius(); }
+
+        bool isReady() const { return ready; }
+
+        // CPU stage: reads a model from file into the meshes vector, with the native importer for .obj files
+        // and Assimp for the other supported extensions, and maps its textures. A binary mesh cache next to
+        // the source file is used instead when it is still up to date. Makes no GL call, so several models
+        // can be prepared on worker threads.
+        void prepare(std::string const &path, MipChainRequests &requests){
+            TRACE_SCOPE_DETAIL("model prepare", path);
             //retrieve the directory path of the filepath
             size_t lastSlash = path.find_last_of("/\\");
             if (lastSlash == std::string::npos)
@@ -60,8 +192,207 @@ class Model{
             else
                 this->directory = path.substr(0, lastSlash);
 
+            bool isObj = path.size() > 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+            bool native = modelImporter == ModelImporter::Native || (modelImporter == ModelImporter::Auto && isObj);
+            unsigned int importFlags = (native ? MODEL_IMPORT_NATIVE_OBJ : MODEL_IMPORT_FLAGS) | MODEL_IMPORT_OPTIMIZED;
+
+            std::string cachePath = path + MESH_CACHE_EXTENSION;
+            uint64_t sourceHash{0};
+            // an .obj is keyed on its .mtl libraries too, either importer reads them
+            bool hashed = isObj ? hashObjSources(path, sourceHash) : hashFile(path, sourceHash);
+            if(hashed && loadFromCache(cachePath, sourceHash, importFlags)){
+                prepareTextures(requests);
+                return;
+            }
+
+            if(native && loadObjMeshes(path)){
+                optimizeMeshes(path);
+                buildLevelsOfDetail(path);
+                prepareTextures(requests);
+                if(hashed){
+                    TRACE_SCOPE("write mesh cache");
+                    writeMeshCache(cachePath, sourceHash, importFlags, meshes);
+                }
+                return;
+            }
+            // the native importer failed, Assimp may still make sense of the file
+            importFlags = MODEL_IMPORT_FLAGS | MODEL_IMPORT_OPTIMIZED;
+
+            //read file via ASSIMP, with an importer of this call's own since it is not thread safe
+            Assimp::Importer importer;
+            const aiScene* scene;
+            {
+                TRACE_SCOPE_DETAIL("assimp import", path);
+                scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+            }
+            //check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode){
+                std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+                return;
+            }
+
             //process ASSIMP's root node recursively
-            processNode(scene->mRootNode, scene);
+            {
+                TRACE_SCOPE("process meshes");
+                meshes.reserve(scene->mNumMeshes);
+                processNode(scene->mRootNode, scene);
+            }
+            optimizeMeshes(path);
+            buildLevelsOfDetail(path);
+            prepareTextures(requests);
+
+            if(hashed){
+                TRACE_SCOPE("write mesh cache");
+                writeMeshCache(cachePath, sourceHash, importFlags, meshes);
+            }
+        }
+
+        // drops whatever a prepare() that didn't complete left behind, the model then uploads empty
+        // like one whose import failed
+        void discardPrepared(){
+            meshes.clear();
+            textures_loaded.clear();
+            loadedByPath.clear();
+            textureKeys.clear();
+            textureChains.clear();
+            sources.clear();
+            cache.close();
+        }
+
+        // GL stage: creates the textures this process doesn't have yet and uploads the geometry.
+        // Call on the context thread once prepare() has returned.
+        void upload(){
+            TRACE_SCOPE("model upload");
+            for(size_t i = 0; i < textures_loaded.size(); i++){
+                bool created{false};
+                textures_loaded[i].id = TextureCache::instance().acquire(textureKeys[i], created);
+                if(created){   // first user of this image in the process
+                    std::cout << "Loading texture: " << textureKeys[i].path << std::endl;
+                    std::cout << "Texture type: " << textures_loaded[i].type << std::endl;
+                    TRACE_SCOPE_DETAIL("texture upload", textureKeys[i].path);
+                    uploadMipChain(textures_loaded[i].id, *textureChains[i], gammaCorrection);
+                }
+            }
+            for(Mesh &mesh : meshes){
+                for(Texture &texture : mesh.textures){
+                    texture.id = textures_loaded[loadedByPath[texture.path]].id;
+                }
+            }
+
+            if(cache.isOpen()){
+                geometry.build(meshes, sources);
+            } else {
+                geometry.build(meshes);
+            }
+            if(instances){
+                geometry.attachInstances(*instances);
+            }
+            if(!keepGeometry){
+                for(Mesh &mesh : meshes){
+                    mesh.releaseGeometry();
+                }
+            }
+
+            // the pixels and the mapped mesh cache now live in GL buffers
+            textureChains.clear();
+            sources.clear();
+            cache.close();
+            ready = true;
+        }
+
+    private:
+        // builds the meshes from a valid mesh cache, returns false on a miss
+        bool loadFromCache(std::string const &cachePath, uint64_t sourceHash, unsigned int importFlags){
+            TRACE_SCOPE("mesh cache read");
+            if(!cache.open(cachePath, sourceHash, importFlags)){
+                return false;
+            }
+
+            std::cout << "Loading cached meshes: " << cachePath << std::endl;
+            meshes.reserve(cache.getMeshes().size());
+            sources.reserve(cache.getMeshes().size());
+            for(const CachedMesh &cached : cache.getMeshes()){
+                std::vector<Texture> textures;
+                textures.reserve(cached.textures.size());
+                for(const CachedTexture &texture : cached.textures){
+                    textures.push_back(loadTexture(texture.path.c_str(), texture.type));
+                }
+                meshes.emplace_back(std::move(textures));
+                // uploaded straight from the mapping, no CPU-side copy is kept
+                sources.push_back({cached.vertices, cached.vertexCount, cached.indices, cached.indexCount, cached.lods, cached.lodCount});
+            }
+            return true;
+        }
+
+        // reorders every imported mesh for the vertex cache, overdraw and vertex fetch (see MeshOptimizer.hpp),
+        // the result is what the mesh cache stores
+        void optimizeMeshes(std::string const &path){
+            TRACE_SCOPE("optimize meshes");
+            std::vector<MeshOptimizationStats> stats(meshes.size());
+            ThreadPool::shared().parallelFor(meshes.size(), [&](size_t i){
+                stats[i] = optimizeMesh(meshes[i].vertices, meshes[i].indices);
+            });
+
+            MeshOptimizationStats total;
+            for(const MeshOptimizationStats &mesh : stats){
+                total.add(mesh);
+            }
+            // formatted apart, models are prepared on several threads sharing std::cout
+            std::ostringstream report;
+            report << std::fixed << std::setprecision(3) << "Optimized meshes of " << path << ": "
+                   << total.triangles << " triangles, " << total.verticesBefore << " -> " << total.verticesAfter << " vertices, "
+                   << "ACMR " << total.acmrBefore() << " -> " << total.acmrAfter() << ", "
+                   << "ATVR " << total.atvrBefore() << " -> " << total.atvrAfter() << "\n";
+            std::cout << report.str() << std::flush;
+        }
+
+        // appends the simplified levels of detail of every mesh to its index buffer (see MeshSimplifier.hpp),
+        // stored in the mesh cache along with the full meshes
+        void buildLevelsOfDetail(std::string const &path){
+            TRACE_SCOPE("build levels of detail");
+            std::vector<MeshLodStats> stats(meshes.size());
+            ThreadPool::shared().parallelFor(meshes.size(), [&](size_t i){
+                stats[i] = generateLods(meshes[i].vertices, meshes[i].indices, meshes[i].lods);
+            });
+
+            MeshLodStats total;
+            for(const MeshLodStats &mesh : stats){
+                total.add(mesh);
+            }
+            std::ostringstream report;
+            report << "Levels of detail of " << path << ":";
+            for(size_t level = 0; level < total.levels; level++){
+                report << (level == 0 ? " " : " / ") << total.triangles[level];
+            }
+            report << " triangles\n";
+            std::cout << report.str() << std::flush;
+        }
+
+        // reads an .obj file with the native importer, one mesh per material
+        bool loadObjMeshes(std::string const &path){
+            ObjScene scene;
+            if(!loadObj(path, scene)){
+                return false;
+            }
+
+            meshes.reserve(scene.meshes.size());
+            for(ObjMesh &mesh : scene.meshes){
+                // same texture order as processMesh
+                std::vector<Texture> textures;
+                if(mesh.material >= 0){
+                    const ObjMaterial &material = scene.materials[mesh.material];
+                    if(!material.diffuseMap.empty())
+                        textures.push_back(loadTexture(material.diffuseMap.c_str(), "texture_diffuse"));
+                    if(!material.specularMap.empty())
+                        textures.push_back(loadTexture(material.specularMap.c_str(), "texture_specular"));
+                    if(!material.normalMap.empty())
+                        textures.push_back(loadTexture(material.normalMap.c_str(), "texture_normal"));
+                    if(!material.ambientMap.empty())
+                        textures.push_back(loadTexture(material.ambientMap.c_str(), "texture_height"));
+                }
+                meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures));
+            }
+            return true;
         }
 
         // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -86,55 +417,8 @@ class Model{
             std::vector<Texture> textures;
             aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 
-            // walk through each of the mesh's vertices
-            for(unsigned int i = 0; i < mesh->mNumVertices; i++){
-                Vertex vertex;
-                glm::vec3 vector;// we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-                //positions
-                vector.x = mesh->mVertices[i].x;
-                vector.y = mesh->mVertices[i].y;
-                vector.z = mesh->mVertices[i].z;
-                vertex.Position = vector;
-                //normals
-                if(mesh->HasNormals()){
-                    vector.x = mesh->mNormals[i].x;
-                    vector.y = mesh->mNormals[i].y;
-                    vector.z = mesh->mNormals[i].z;
-                    vertex.Normal = vector;
-                }
-                //texture coordinates
-                if(mesh->mTextureCoords[0]) //does the mesh contain texture coordinates?
-                {
-                    glm::vec2 vec;
-                    // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                    // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                    vec.x = mesh->mTextureCoords[0][i].x;
-                    vec.y = mesh->mTextureCoords[0][i].y;
-                    vertex.TexCoords = vec;
-                    //tangent
-                    vector.x = mesh->mTangents[i].x;
-                    vector.y = mesh->mTangents[i].y;
-                    vector.z = mesh->mTangents[i].z;
-                    vertex.Tangent = vector;
-                    //bitangent
-                    vector.x = mesh->mBitangents[i].x;
-                    vector.y = mesh->mBitangents[i].y;
-                    vector.z = mesh->mBitangents[i].x;
-                    vertex.Bitangent = vector;
-                } else {
-                    vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-                }
-                vertices.push_back(vertex);
-            }
+            readAssimpGeometry(mesh, vertices, indices);
 
-            // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-            for(unsigned int i = 0; i < mesh->mNumFaces; i++){
-                aiFace face = mesh->mFaces[i];
-                //retrieve all indices of the face and store them in the indices vector
-                for(unsigned int j = 0; j < face.mNumIndices; j++){
-                    indices.push_back(face.mIndices[j]);
-                }
-            }
             // process materials
             //aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
             // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -145,17 +429,13 @@ class Model{
             // normal: texture_normalN
 
             // 1. diffuse maps
-            std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+            loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
             // 2. specular maps
-            std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+            loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
             // 3. normal maps
-            std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-            textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+            loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
             // 4. height maps
-            std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-            textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+            loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
             
             // Cargar propiedades de materiales tipo Phong
             aiColor3D diffuseColor(0.f, 0.f, 0.f);
@@ -175,85 +455,65 @@ class Model{
             if (material->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS)
                 std::cout << "Shininess: " << shininess << "\n";
 
-            return Mesh(vertices, indices, textures);
+            return Mesh(std::move(vertices), std::move(indices), std::move(textures));
         }
 
         // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName)
+    // the required info is appended to textures as Texture structs.
+    void loadMaterialTextures(aiMaterial *mat, aiTextureType type, const std::string &typeName, std::vector<Texture> &textures)
     {
-        std::vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                std::cout << "Looking for texture in: " << directory << std::endl;
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-                std::cout << "Loading texture: " << str.C_Str() << std::endl;
-                std::cout << "Texture type: " << typeName << std::endl;
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
-        return textures;
     }
 
-};
-
-inline unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
-{
-    std::string filename = directory + "/" + std::string(path);
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // maps (or bakes, the first time) the mip chains of every texture of the model concurrently on the
+    // shared pool, an image already requested by another model is waited for instead
+    void prepareTextures(MipChainRequests &requests)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        textureChains.resize(textures_loaded.size());
+        ThreadPool::shared().parallelFor(textures_loaded.size(), [&](size_t i){
+            textureChains[i] = requests.get(textureKeys[i]);
+        });
     }
-    else
+
+    // returns the texture for the given path, without a GL name until upload(). Each image is loaded once
+    // per process: the model looks it up in its own table first, then upload() in the shared TextureCache.
+    Texture loadTexture(const char *path, const std::string &typeName)
     {
-        std::cout << "Texture failed to load at: " << filename << std::endl;
-        stbi_image_free(data);
+        auto loaded = loadedByPath.find(path);
+        if(loaded != loadedByPath.end())
+        {
+            return textures_loaded[loaded->second]; // a texture with the same filepath has already been loaded (optimization)
+        }
+
+        Texture texture;
+        texture.id = 0;
+        texture.type = typeName;
+        texture.path = path;
+        loadedByPath.emplace(texture.path, textures_loaded.size());
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+        textureKeys.push_back({resolveTexturePath(this->directory, path), gammaCorrection, flipTextures});
+        return texture;
     }
 
-    return textureID;
-}
+    private:
+        // path -> index in textures_loaded
+        std::unordered_map<std::string, size_t> loadedByPath;
+        // cache key and pixels of each entry of textures_loaded, the pixels until upload()
+        std::vector<TextureKey> textureKeys;
+        std::vector<std::shared_ptr<const MipChain>> textureChains;
+        // mesh cache the meshes were read from, mapped until upload()
+        MeshCacheReader cache;
+        std::vector<MeshData> sources;
+        ModelImporter modelImporter;
+        bool ready;
+        ClockInstances *instances;
+
+};
 
 
 #endif //!_MODEL_HPP
\ No newline at end of file
@@ -0,0 +1,121 @@
+#ifndef MODEL_LOADER_HPP
+#define MODEL_LOADER_HPP
+
+#include "Model.hpp"
+#include "TextureLoader.hpp"
+#include "ThreadPool.hpp"
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Loads several models at once. The CPU stage of each one (Model::prepare) is a task on the shared
+// pool, every task with its own Assimp::Importer, and textures shared between the models are mapped
+// only once. The GL stage (Model::upload) is left to the context thread, which picks up whatever
+// finished between two frames, so rendering can start before every model is there.
+class ModelLoader{
+
+    public:
+        ModelLoader() : finished(true){}
+
+        // a task still running would write into a destroyed model
+        ~ModelLoader(){
+            for(Job &job : jobs){
+                if(job.prepared.valid()){
+                    job.prepared.wait();
+                }
+            }
+        }
+
+        ModelLoader(const ModelLoader &) = delete;
+        ModelLoader &operator=(const ModelLoader &) = delete;
+
+        // starts loading a model, which draws nothing until it is finished. The model is owned by the
+        // loader and lives as long as it does.
+        Model &load(const std::string &path, bool gamma = false, bool flip = true, ModelImporter importer = ModelImporter::Auto, bool keepGeometry = true){
+            Job job;
+            job.path = path;
+            job.model = std::make_unique<Model>(DeferredModelLoad{}, gamma, flip, importer, keepGeometry);
+            Model *model = job.model.get();
+            job.prepared = ThreadPool::shared().submit([this, model, path]{
+                model->prepare(path, requests);
+            });
+            jobs.push_back(std::move(job));
+            finished = false;
+            return *model;
+        }
+
+        // uploads the models whose CPU stage is done, without waiting for the others. Call on the GL
+        // thread, returns true once every model is ready.
+        bool finishReady(){
+            if(finished){
+                return true;
+            }
+            bool allReady{true};
+            for(Job &job : jobs){
+                if(job.model->isReady()){
+                    continue;
+                }
+                if(job.prepared.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+                    finish(job);
+                } else {
+                    allReady = false;
+                }
+            }
+            if(allReady){
+                done();
+            }
+            return allReady;
+        }
+
+        // waits for every model and uploads it, on the GL thread
+        void finishAll(){
+            if(finished){
+                return;
+            }
+            for(Job &job : jobs){
+                if(!job.model->isReady()){
+                    finish(job);
+                }
+            }
+            done();
+        }
+
+    private:
+        struct Job {
+            std::string path;
+            std::unique_ptr<Model> model;
+            std::future<void> prepared;
+        };
+
+        std::vector<Job> jobs;
+        MipChainRequests requests;
+        bool finished;
+
+        // uploads a model once its CPU stage returned. A prepare that threw is reported here instead
+        // of escaping into the frame loop, and its model is uploaded empty like a failed import.
+        void finish(Job &job){
+            try{
+                job.prepared.get();
+            } catch(const std::exception &e){
+                std::cout << "ERROR::MODEL::PREPARE_FAILED " << job.path << ": " << e.what() << std::endl;
+                job.model->discardPrepared();
+            } catch(...){
+                std::cout << "ERROR::MODEL::PREPARE_FAILED " << job.path << std::endl;
+                job.model->discardPrepared();
+            }
+            job.model->upload();
+        }
+
+        void done(){
+            // the uploaded models don't need the shared pixels anymore
+            requests.clear();
+            finished = true;
+        }
+};
+
+#endif //!_MODEL_LOADER_HPP
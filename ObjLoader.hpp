@@ -0,0 +1,603 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Wavefront .obj/.mtl importer for the Blender exports in res/, a lighter alternative to Assimp.
+//
+// The .obj file is mapped and cut into chunks at line boundaries that are parsed concurrently on the
+// shared pool, with std::from_chars for the numbers. Face corners keep their raw indices until every
+// chunk knows how many positions, texture coordinates and normals came before it, then polygons are
+// fan-triangulated and each distinct position/uv/normal triple becomes one Vertex. There is one mesh
+// per material, like the draw records end up grouping them anyway. Missing normals are smoothed per
+// position and the tangent space is computed from the uvs, matching MODEL_IMPORT_FLAGS.
+
+// what the model shader can use from an .mtl material, map paths relative to the .obj directory
+struct ObjMaterial {
+    std::string name;
+    std::string diffuseMap;    // map_Kd
+    std::string specularMap;   // map_Ks
+    std::string normalMap;     // map_Bump, bump or norm
+    std::string ambientMap;    // map_Ka
+};
+
+struct ObjMesh {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    // index into ObjScene::materials, -1 without material
+    int material;
+};
+
+struct ObjScene {
+    std::vector<ObjMaterial> materials;
+    std::vector<ObjMesh> meshes;
+};
+
+namespace objdetail {
+
+    constexpr int NONE{-1};
+    constexpr size_t MIN_CHUNK_SIZE{64 * 1024};
+
+    // indices of one polygon corner into the position, texture coordinate and normal arrays.
+    // Relative (negative) indices are resolved against the counts seen so far in the chunk and
+    // flagged, they get the chunk's base once known.
+    struct Corner {
+        int position;
+        int texcoord;
+        int normal;
+        uint8_t relative;   // bit 0 position, bit 1 texcoord, bit 2 normal
+    };
+
+    struct Face {
+        uint32_t firstCorner;
+        uint32_t cornerCount;
+        // index into Chunk::materials, NONE to keep the material of the previous face
+        int use;
+    };
+
+    struct Chunk {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texcoords;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners;
+        std::vector<Face> faces;
+        std::vector<std::string> materials;   // usemtl names, in order
+        std::vector<std::string> libraries;   // mtllib
+        // usemtl not followed by a face yet, at the end of the chunk it applies to the next chunk
+        int currentUse{NONE};
+        bool failed{false};
+    };
+
+    inline bool isSpace(char c){
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char *skipSpaces(const char *cursor, const char *end){
+        while(cursor < end && isSpace(*cursor))
+            cursor++;
+        return cursor;
+    }
+
+    inline const char *parseFloat(const char *cursor, const char *end, float &value){
+        cursor = skipSpaces(cursor, end);
+        // from_chars rejects the leading '+' some exporters write
+        if(cursor < end && *cursor == '+')
+            cursor++;
+        std::from_chars_result result = std::from_chars(cursor, end, value);
+        if(result.ec != std::errc())
+        {
+            value = 0.0f;
+            return cursor;
+        }
+        return result.ptr;
+    }
+
+    inline const char *parseInt(const char *cursor, const char *end, int &value, bool &parsed){
+        std::from_chars_result result = std::from_chars(cursor, end, value);
+        parsed = result.ec == std::errc();
+        return parsed ? result.ptr : cursor;
+    }
+
+    // the rest of the line without surrounding blanks
+    inline std::string_view restOfLine(const char *cursor, const char *lineEnd){
+        cursor = skipSpaces(cursor, lineEnd);
+        while(lineEnd > cursor && isSpace(lineEnd[-1]))
+            lineEnd--;
+        return std::string_view(cursor, static_cast<size_t>(lineEnd - cursor));
+    }
+
+    // resolves one index of a corner: 1-based absolute, or relative to the count seen so far
+    inline int cornerIndex(int raw, size_t localCount, uint8_t flag, uint8_t &relative){
+        if(raw > 0)
+            return raw - 1;
+        relative |= flag;
+        return static_cast<int>(localCount) + raw;
+    }
+
+    inline void parseFace(const char *cursor, const char *lineEnd, Chunk &chunk){
+        Face face;
+        face.firstCorner = static_cast<uint32_t>(chunk.corners.size());
+        face.cornerCount = 0;
+        face.use = chunk.currentUse;
+        chunk.currentUse = NONE;
+
+        while(true)
+        {
+            cursor = skipSpaces(cursor, lineEnd);
+            if(cursor >= lineEnd)
+                break;
+
+            Corner corner{NONE, NONE, NONE, 0};
+            int raw;
+            bool parsed;
+            cursor = parseInt(cursor, lineEnd, raw, parsed);
+            if(!parsed)
+            {
+                chunk.failed = true;
+                return;
+            }
+            corner.position = cornerIndex(raw, chunk.positions.size(), 1, corner.relative);
+            if(cursor < lineEnd && *cursor == '/')
+            {
+                cursor++;
+                cursor = parseInt(cursor, lineEnd, raw, parsed);
+                if(parsed)
+                    corner.texcoord = cornerIndex(raw, chunk.texcoords.size(), 2, corner.relative);
+                if(cursor < lineEnd && *cursor == '/')
+                {
+                    cursor++;
+                    cursor = parseInt(cursor, lineEnd, raw, parsed);
+                    if(parsed)
+                        corner.normal = cornerIndex(raw, chunk.normals.size(), 4, corner.relative);
+                }
+            }
+            // skip whatever else this token holds
+            while(cursor < lineEnd && !isSpace(*cursor))
+                cursor++;
+
+            chunk.corners.push_back(corner);
+            face.cornerCount++;
+        }
+
+        if(face.cornerCount < 3)
+        {   // points and lines have nothing to render
+            chunk.corners.resize(face.firstCorner);
+            if(face.use != NONE)
+                chunk.currentUse = face.use;
+            return;
+        }
+        chunk.faces.push_back(face);
+    }
+
+    inline void parseChunk(const char *cursor, const char *end, Chunk &chunk){
+        while(cursor < end)
+        {
+            const char *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+            if(!lineEnd)
+                lineEnd = end;
+
+            const char *token = skipSpaces(cursor, lineEnd);
+            if(token + 1 < lineEnd && token[0] == 'v' && isSpace(token[1]))
+            {
+                glm::vec3 position;
+                token = parseFloat(token + 2, lineEnd, position.x);
+                token = parseFloat(token, lineEnd, position.y);
+                parseFloat(token, lineEnd, position.z);
+                chunk.positions.push_back(position);
+            }
+            else if(token + 2 < lineEnd && token[0] == 'v' && token[1] == 't' && isSpace(token[2]))
+            {
+                glm::vec2 texcoord;
+                token = parseFloat(token + 3, lineEnd, texcoord.x);
+                parseFloat(token, lineEnd, texcoord.y);
+                chunk.texcoords.push_back(texcoord);
+            }
+            else if(token + 2 < lineEnd && token[0] == 'v' && token[1] == 'n' && isSpace(token[2]))
+            {
+                glm::vec3 normal;
+                token = parseFloat(token + 3, lineEnd, normal.x);
+                token = parseFloat(token, lineEnd, normal.y);
+                parseFloat(token, lineEnd, normal.z);
+                chunk.normals.push_back(normal);
+            }
+            else if(token + 1 < lineEnd && token[0] == 'f' && isSpace(token[1]))
+            {
+                parseFace(token + 2, lineEnd, chunk);
+                if(chunk.failed)
+                    return;
+            }
+            else if(static_cast<size_t>(lineEnd - token) > 7 && std::memcmp(token, "usemtl", 6) == 0 && isSpace(token[6]))
+            {
+                chunk.currentUse = static_cast<int>(chunk.materials.size());
+                chunk.materials.emplace_back(restOfLine(token + 7, lineEnd));
+            }
+            else if(static_cast<size_t>(lineEnd - token) > 7 && std::memcmp(token, "mtllib", 6) == 0 && isSpace(token[6]))
+            {
+                chunk.libraries.emplace_back(restOfLine(token + 7, lineEnd));
+            }
+            // comments, objects, groups and smoothing groups don't change the output
+
+            cursor = lineEnd + 1;
+        }
+    }
+
+    // the last token of a map statement is the file, the ones before it are options
+    inline std::string mapFile(std::string_view statement){
+        size_t start = statement.find_last_of(" \t");
+        return std::string(start == std::string_view::npos ? statement : statement.substr(start + 1));
+    }
+
+    inline void parseMaterialLibrary(const std::string &path, std::vector<ObjMaterial> &materials){
+        MappedFile file;
+        if(!file.open(path))
+        {
+            std::cout << "ERROR::OBJ::MATERIAL_LIBRARY_NOT_FOUND " << path << std::endl;
+            return;
+        }
+
+        const char *cursor = reinterpret_cast<const char *>(file.data());
+        const char *end = cursor + file.size();
+        ObjMaterial *material = nullptr;
+        while(cursor < end)
+        {
+            const char *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+            if(!lineEnd)
+                lineEnd = end;
+
+            const char *token = skipSpaces(cursor, lineEnd);
+            const char *keyEnd = token;
+            while(keyEnd < lineEnd && !isSpace(*keyEnd))
+                keyEnd++;
+            std::string_view key(token, static_cast<size_t>(keyEnd - token));
+            std::string_view value = restOfLine(keyEnd, lineEnd);
+
+            if(key == "newmtl")
+            {
+                materials.push_back(ObjMaterial{std::string(value), {}, {}, {}, {}});
+                material = &materials.back();
+            }
+            else if(material && key == "map_Kd")
+                material->diffuseMap = mapFile(value);
+            else if(material && key == "map_Ks")
+                material->specularMap = mapFile(value);
+            else if(material && (key == "map_Bump" || key == "map_bump" || key == "bump" || key == "norm"))
+                material->normalMap = mapFile(value);
+            else if(material && key == "map_Ka")
+                material->ambientMap = mapFile(value);
+
+            cursor = lineEnd + 1;
+        }
+    }
+
+    struct CornerKey {
+        int position;
+        int texcoord;
+        int normal;
+
+        bool operator==(const CornerKey &other) const{
+            return position == other.position && texcoord == other.texcoord && normal == other.normal;
+        }
+    };
+
+    struct CornerKeyHash {
+        size_t operator()(const CornerKey &key) const{
+            uint64_t hash = static_cast<uint32_t>(key.position) * 0x9E3779B97F4A7C15ull;
+            hash ^= static_cast<uint32_t>(key.texcoord) * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+            hash ^= static_cast<uint32_t>(key.normal) * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    // a face after the chunks were merged, pointing at its chunk's corners
+    struct MergedFace {
+        const Corner *corners;
+        uint32_t cornerCount;
+    };
+
+    // per-vertex tangent space from the uvs, accumulated over the triangles and orthogonalized
+    inline void computeTangents(ObjMesh &mesh){
+        std::vector<glm::vec3> tangents(mesh.vertices.size(), glm::vec3(0.0f));
+        std::vector<glm::vec3> bitangents(mesh.vertices.size(), glm::vec3(0.0f));
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const Vertex &a = mesh.vertices[mesh.indices[i]];
+            const Vertex &b = mesh.vertices[mesh.indices[i + 1]];
+            const Vertex &c = mesh.vertices[mesh.indices[i + 2]];
+            glm::vec3 edge1 = b.Position - a.Position;
+            glm::vec3 edge2 = c.Position - a.Position;
+            glm::vec2 uv1 = b.TexCoords - a.TexCoords;
+            glm::vec2 uv2 = c.TexCoords - a.TexCoords;
+            float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+            if(std::abs(determinant) < 1e-12f)
+                continue;
+            float r = 1.0f / determinant;
+            glm::vec3 tangent = (edge1 * uv2.y - edge2 * uv1.y) * r;
+            glm::vec3 bitangent = (edge2 * uv1.x - edge1 * uv2.x) * r;
+            for(int corner = 0; corner < 3; corner++)
+            {
+                tangents[mesh.indices[i + corner]] += tangent;
+                bitangents[mesh.indices[i + corner]] += bitangent;
+            }
+        }
+        for(size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            Vertex &vertex = mesh.vertices[v];
+            glm::vec3 tangent = tangents[v] - vertex.Normal * glm::dot(vertex.Normal, tangents[v]);
+            if(glm::dot(tangent, tangent) > 0.0f)
+                vertex.Tangent = glm::normalize(tangent);
+            if(glm::dot(bitangents[v], bitangents[v]) > 0.0f)
+                vertex.Bitangent = glm::normalize(bitangents[v]);
+        }
+    }
+
+    // builds one mesh from the faces of a material: fan triangulation and vertex deduplication
+    inline void buildMesh(const std::vector<MergedFace> &faces, const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &texcoords, const std::vector<glm::vec3> &normals, ObjMesh &mesh){
+        size_t cornerCount = 0;
+        size_t triangleCount = 0;
+        for(const MergedFace &face : faces)
+        {
+            cornerCount += face.cornerCount;
+            triangleCount += face.cornerCount - 2;
+        }
+
+        std::unordered_map<CornerKey, unsigned int, CornerKeyHash> lookup;
+        lookup.reserve(cornerCount);
+        mesh.vertices.reserve(cornerCount);
+        mesh.indices.reserve(triangleCount * 3);
+
+        bool missingNormals{false};
+        auto vertexOf = [&](const Corner &corner) -> unsigned int {
+            CornerKey key{corner.position, corner.texcoord, corner.normal};
+            auto found = lookup.find(key);
+            if(found != lookup.end())
+                return found->second;
+
+            Vertex vertex{};
+            vertex.Position = glm::vec3(0.0f);
+            vertex.Normal = glm::vec3(0.0f);
+            vertex.TexCoords = glm::vec2(0.0f);
+            vertex.Tangent = glm::vec3(0.0f);
+            vertex.Bitangent = glm::vec3(0.0f);
+            if(corner.position >= 0 && static_cast<size_t>(corner.position) < positions.size())
+                vertex.Position = positions[corner.position];
+            if(corner.texcoord >= 0 && static_cast<size_t>(corner.texcoord) < texcoords.size())
+                vertex.TexCoords = texcoords[corner.texcoord];
+            if(corner.normal >= 0 && static_cast<size_t>(corner.normal) < normals.size())
+                vertex.Normal = normals[corner.normal];
+            else
+                missingNormals = true;
+
+            unsigned int index = static_cast<unsigned int>(mesh.vertices.size());
+            mesh.vertices.push_back(vertex);
+            lookup.emplace(key, index);
+            return index;
+        };
+
+        for(const MergedFace &face : faces)
+        {
+            unsigned int first = vertexOf(face.corners[0]);
+            unsigned int previous = vertexOf(face.corners[1]);
+            for(uint32_t i = 2; i < face.cornerCount; i++)
+            {
+                unsigned int current = vertexOf(face.corners[i]);
+                mesh.indices.push_back(first);
+                mesh.indices.push_back(previous);
+                mesh.indices.push_back(current);
+                previous = current;
+            }
+        }
+
+        if(missingNormals)
+        {   // smooth normals: every vertex at a position gets the area weighted average of its faces
+            std::unordered_map<int, glm::vec3> smooth;
+            std::vector<int> positionOf(mesh.vertices.size(), NONE);
+            for(const auto &entry : lookup)
+                positionOf[entry.second] = entry.first.position;
+            for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            {
+                const glm::vec3 &a = mesh.vertices[mesh.indices[i]].Position;
+                const glm::vec3 &b = mesh.vertices[mesh.indices[i + 1]].Position;
+                const glm::vec3 &c = mesh.vertices[mesh.indices[i + 2]].Position;
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                for(int corner = 0; corner < 3; corner++)
+                    smooth[positionOf[mesh.indices[i + corner]]] += normal;
+            }
+            for(size_t v = 0; v < mesh.vertices.size(); v++)
+            {
+                Vertex &vertex = mesh.vertices[v];
+                if(vertex.Normal != glm::vec3(0.0f))
+                    continue;
+                glm::vec3 normal = smooth[positionOf[v]];
+                if(glm::dot(normal, normal) > 0.0f)
+                    vertex.Normal = glm::normalize(normal);
+            }
+        }
+
+        computeTangents(mesh);
+    }
+}
+
+// imports an .obj file and the .mtl libraries it references, returns false if it can't be read or parsed
+inline bool loadObj(const std::string &path, ObjScene &scene)
+{
+    using namespace objdetail;
+
+    scene.materials.clear();
+    scene.meshes.clear();
+
+    MappedFile file;
+    if(!file.open(path))
+    {
+        std::cout << "ERROR::OBJ::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    const char *data = reinterpret_cast<const char *>(file.data());
+    const char *end = data + file.size();
+
+    // chunk boundaries, each moved forward to the start of a line
+    ThreadPool &pool = ThreadPool::shared();
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pool.size() * 4, file.size() / MIN_CHUNK_SIZE));
+    std::vector<const char *> bounds(chunkCount + 1, end);
+    bounds[0] = data;
+    for(size_t i = 1; i < chunkCount; i++)
+    {
+        const char *bound = std::max(bounds[i - 1], data + file.size() * i / chunkCount);
+        const char *newline = static_cast<const char *>(std::memchr(bound, '\n', static_cast<size_t>(end - bound)));
+        bounds[i] = newline ? newline + 1 : end;
+    }
+
+    std::vector<Chunk> chunks(chunkCount);
+    {
+        TRACE_SCOPE_DETAIL("obj parse", path);
+        pool.parallelFor(chunkCount, [&](size_t i){
+            parseChunk(bounds[i], bounds[i + 1], chunks[i]);
+        });
+    }
+
+    // concatenate the attributes and give relative indices their chunk's base
+    size_t positionCount = 0, texcoordCount = 0, normalCount = 0;
+    for(Chunk &chunk : chunks)
+    {
+        if(chunk.failed)
+        {
+            std::cout << "ERROR::OBJ::INVALID_FACE " << path << std::endl;
+            return false;
+        }
+        for(Corner &corner : chunk.corners)
+        {
+            if(corner.relative & 1)
+                corner.position += static_cast<int>(positionCount);
+            if(corner.relative & 2)
+                corner.texcoord += static_cast<int>(texcoordCount);
+            if(corner.relative & 4)
+                corner.normal += static_cast<int>(normalCount);
+        }
+        positionCount += chunk.positions.size();
+        texcoordCount += chunk.texcoords.size();
+        normalCount += chunk.normals.size();
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texcoords;
+    std::vector<glm::vec3> normals;
+    positions.reserve(positionCount);
+    texcoords.reserve(texcoordCount);
+    normals.reserve(normalCount);
+    for(const Chunk &chunk : chunks)
+    {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+
+    // materials, looked up by the usemtl names
+    std::string directory = ".";
+    size_t lastSlash = path.find_last_of("/\\");
+    if(lastSlash != std::string::npos)
+        directory = path.substr(0, lastSlash);
+    for(const Chunk &chunk : chunks)
+    {
+        for(const std::string &library : chunk.libraries)
+            parseMaterialLibrary(directory + "/" + library, scene.materials);
+    }
+    std::unordered_map<std::string, int> materialByName;
+    for(size_t i = 0; i < scene.materials.size(); i++)
+        materialByName.emplace(scene.materials[i].name, static_cast<int>(i));
+
+    // faces grouped by material, in the order the materials are first used
+    std::vector<std::vector<MergedFace>> groups;
+    std::vector<int> groupMaterials;
+    std::unordered_map<int, size_t> groupOf;
+    int material = NONE;
+    for(const Chunk &chunk : chunks)
+    {
+        for(const Face &face : chunk.faces)
+        {
+            if(face.use != NONE)
+            {
+                auto found = materialByName.find(chunk.materials[face.use]);
+                material = found != materialByName.end() ? found->second : NONE;
+            }
+            auto group = groupOf.find(material);
+            if(group == groupOf.end())
+            {
+                group = groupOf.emplace(material, groups.size()).first;
+                groups.emplace_back();
+                groupMaterials.push_back(material);
+            }
+            groups[group->second].push_back({chunk.corners.data() + face.firstCorner, face.cornerCount});
+        }
+        if(chunk.currentUse != NONE)
+        {
+            auto found = materialByName.find(chunk.materials[chunk.currentUse]);
+            material = found != materialByName.end() ? found->second : NONE;
+        }
+    }
+
+    scene.meshes.resize(groups.size());
+    {
+        TRACE_SCOPE("obj build meshes");
+        pool.parallelFor(groups.size(), [&](size_t i){
+            scene.meshes[i].material = groupMaterials[i];
+            buildMesh(groups[i], positions, texcoords, normals, scene.meshes[i]);
+        });
+    }
+    return true;
+}
+
+// hashes an .obj file together with the .mtl libraries it references, so that editing a material
+// (texture paths, or how the native importer groups the faces) changes the hash as well. Returns
+// false if the .obj can't be read; a missing library is folded in by name only.
+inline bool hashObjSources(const std::string &path, uint64_t &hash)
+{
+    MappedFile file;
+    if(!file.open(path))
+        return false;
+    hash = hashBytes(file.data(), file.size());
+
+    std::string directory = ".";
+    size_t lastSlash = path.find_last_of("/\\");
+    if(lastSlash != std::string::npos)
+        directory = path.substr(0, lastSlash);
+
+    std::string_view text(reinterpret_cast<const char *>(file.data()), file.size());
+    for(size_t found = text.find("mtllib"); found != std::string_view::npos; found = text.find("mtllib", found + 6))
+    {
+        // only a statement at the start of a line
+        size_t lineStart = found;
+        while(lineStart > 0 && objdetail::isSpace(text[lineStart - 1]))
+            lineStart--;
+        if((lineStart > 0 && text[lineStart - 1] != '\n') || found + 6 >= text.size() || !objdetail::isSpace(text[found + 6]))
+            continue;
+
+        size_t lineEnd = text.find('\n', found);
+        if(lineEnd == std::string_view::npos)
+            lineEnd = text.size();
+        std::string_view library = objdetail::restOfLine(text.data() + found + 7, text.data() + lineEnd);
+        hash = hashBytes(reinterpret_cast<const unsigned char *>(library.data()), library.size(), hash);
+
+        MappedFile material;
+        if(material.open(directory + "/" + std::string(library)))
+            hash = hashBytes(material.data(), material.size(), hash);
+    }
+    return true;
+}
+
+#endif //!_OBJ_LOADER_HPP
@@ -1,13 +1,58 @@
 #include "Shader.hpp"
+#include "GLState.hpp"
+#include "MappedFile.hpp"
+#include "Trace.hpp"
 #include "glad/include/glad/glad.h"
-#include <GL/glext.h>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+
+// Linked programs are cached next to the fragment shader. The key covers both preprocessed sources
+// and the driver strings, a mismatch of any of them means the binary is recompiled and rewritten.
+static constexpr uint32_t PROGRAM_CACHE_VERSION{1};
+static constexpr char PROGRAM_CACHE_MAGIC[8] = {'G', 'L', 'C', 'P', 'R', 'O', 'G', '\0'};
+
+struct ProgramCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;    // binaryFormat reported by glGetProgramBinary
+    uint64_t key;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+static uint64_t hashString(const std::string &text, uint64_t hash = 14695981039346656037ull){
+    // the terminator keeps "ab"+"c" and "a"+"bc" apart
+    return hashBytes(reinterpret_cast<const unsigned char *>(text.c_str()), text.size() + 1, hash);
+}
+
+// inserts the defines right after the #version directive, which must stay the first statement
+static std::string injectDefines(const std::string &code, const std::string &defines){
+
+    if(defines.empty()){
+        return code;
+    }
+    size_t version = code.find("#version");
+    size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+    if(lineEnd == std::string::npos){
+        return defines + code;
+    }
+    return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath){
+}
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath) : Shader(vertexPath, fragmentPath, std::string()){
+}
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath, const std::string &defines){
     
+    TRACE_SCOPE_DETAIL("shader", std::string(fragmentPath) + "\n" + defines);
+
     std::string vertexCode;
     std::string fragmentCode;
     std::ifstream vShaderFile;
@@ -27,13 +72,43 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath){
         vShaderFile.close();
         fShaderFile.close();
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        vertexCode = injectDefines(vShaderStream.str(), defines);
+        fragmentCode = injectDefines(fShaderStream.str(), defines);
     } catch(std::ifstream::failure e) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
+
+    // the binary is only valid for the exact sources and driver it was produced by
+    const char *renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    const char *version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    uint64_t key = hashString(vertexCode);
+    key = hashString(fragmentCode, key);
+    key = hashString(renderer ? renderer : "", key);
+    key = hashString(version ? version : "", key);
+
+    std::string cachePath = std::string(fragmentPath);
+    if(!defines.empty()){
+        char variant[20];
+        std::snprintf(variant, sizeof(variant), ".%016llx", static_cast<unsigned long long>(hashString(defines)));
+        cachePath += variant;
+    }
+    cachePath += PROGRAM_CACHE_EXTENSION;
+    bool binarySupported = GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary;
+
+    if(!binarySupported || !loadProgramBinary(cachePath, key)){
+        compileProgram(vertexCode.c_str(), fragmentCode.c_str(), binarySupported);
+        if(binarySupported){
+            saveProgramBinary(cachePath, key);
+        }
+    }
+
+    cacheUniformLocations();
+
+}
+
+void Shader::compileProgram(const char *vShaderCode, const char *fShaderCode, bool retrievable){
+
+    TRACE_SCOPE("shader compile");
 
     unsigned int vertex, fragment;
     int success;
@@ -60,6 +135,9 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath){
     };
 
     ID = glCreateProgram();
+    if(retrievable){
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
     glLinkProgram(ID);
@@ -75,64 +153,233 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath){
 
 }
 
+bool Shader::loadProgramBinary(const std::string &cachePath, uint64_t key){
+
+    TRACE_SCOPE("shader binary load");
+    MappedFile file;
+    if(!file.open(cachePath)){
+        return false;
+    }
+
+    ProgramCacheHeader header;
+    if(file.size() < sizeof(header)){
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0
+        || header.version != PROGRAM_CACHE_VERSION
+        || header.key != key
+        || file.size() < sizeof(header) + header.length){
+        return false;
+    }
+
+    ID = glCreateProgram();
+    glProgramBinary(ID, header.format, file.data() + sizeof(header), header.length);
+
+    // drivers reject binaries after an update or for a format they no longer accept
+    int success;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if(!success){
+        std::cout << "Shader binary cache rejected by the driver, compiling from source: " << cachePath << std::endl;
+        glDeleteProgram(ID);
+        ID = 0;
+        return false;
+    }
+    return true;
+
+}
+
+void Shader::saveProgramBinary(const std::string &cachePath, uint64_t key) const{
+
+    int length{0};
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0){
+        return;
+    }
+
+    std::vector<char> binary(length);
+    ProgramCacheHeader header;
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    glGetProgramBinary(ID, length, &length, &header.format, binary.data());
+    header.length = static_cast<uint32_t>(length);
+
+    // written aside and renamed, so a concurrent start never maps a half-written file
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(binary.data(), length);
+    out.close();
+    if(!out || std::rename(tempPath.c_str(), cachePath.c_str()) != 0){
+        std::cout << "ERROR::SHADER::CANNOT_WRITE_BINARY_CACHE " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+    }
+
+}
+
+void Shader::cacheUniformLocations(){
+
+    uniformLocations.clear();
+
+    int count{0};
+    int maxLength{0};
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::string name(maxLength > 0 ? maxLength : 1, '\0');
+
+    for(int i = 0; i < count; i++){
+        int length{0};
+        int size{0};
+        GLenum type;
+        glGetActiveUniform(ID, i, maxLength, &length, &size, &type, name.data());
+
+        std::string uniformName(name.data(), length);
+        int location = glGetUniformLocation(ID, uniformName.c_str());
+        // uniforms inside a uniform block have no location of their own
+        if(location < 0){
+            continue;
+        }
+        uniformLocations[uniformName] = location;
+
+        // arrays of basic types are reported once as "name[0]": register the bare name and every element
+        size_t bracket = uniformName.rfind("[0]");
+        if(bracket != std::string::npos && bracket + 3 == uniformName.size()){
+            std::string base = uniformName.substr(0, bracket);
+            uniformLocations[base] = location;
+            for(int j = 1; j < size; j++){
+                std::string element = base + "[" + std::to_string(j) + "]";
+                uniformLocations[element] = glGetUniformLocation(ID, element.c_str());
+            }
+        }
+    }
+}
+
+void Shader::bindUniformBlock(const std::string &blockName, unsigned int binding) const{
+
+    unsigned int index = glGetUniformBlockIndex(ID, blockName.c_str());
+    if(index != GL_INVALID_INDEX){
+        glUniformBlockBinding(ID, index, binding);
+    }
+
+}
+
+int Shader::getUniformLocation(const std::string &name) const{
+
+    auto it = uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
+
+}
+
 void Shader::use(){
     
-    glUseProgram(ID);
+    GLState::instance().useProgram(ID);
 
 }
 
 void Shader::setBool(const std::string &name, bool value) const{
     
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(name), (int)value);
 
 }
 
 void Shader::setInt(const std::string &name, int value) const{
 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
 
 }
 
 void Shader::setFloat(const std::string &name, float value) const{
 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
 
 }
 
 void Shader::setVec2(const std::string &name, const glm::vec2 &value) const{
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec2(const std::string &name, float x, float y) const{ 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    glUniform2f(getUniformLocation(name), x, y); 
 }
 
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const{
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform3fv(getUniformLocation(name), 1, &value[0]); 
 }
 
 void Shader::setVec3(const std::string &name, float x, float y, float z) const{ 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(getUniformLocation(name), x, y, z);
 }
 
 void Shader::setVec4(const std::string &name, const glm::vec4 &value) const{ 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(getUniformLocation(name), 1, &value[0]);
 }
     
 void Shader::setVec4(const std::string &name, float x, float y, float z, float w) const{ 
     
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    glUniform4f(getUniformLocation(name), x, y, z, w); 
 
 }
 
 void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const{
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const{
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const{
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+// Pre-resolved location setters
+// ------------------------------------------------------------------------
+void Shader::setBool(int location, bool value) const{
+    glUniform1i(location, (int)value);
+}
+
+void Shader::setInt(int location, int value) const{
+    glUniform1i(location, value);
+}
+
+void Shader::setFloat(int location, float value) const{
+    glUniform1f(location, value);
+}
+
+void Shader::setVec2(int location, const glm::vec2 &value) const{
+    glUniform2fv(location, 1, &value[0]);
+}
+
+void Shader::setVec2(int location, float x, float y) const{
+    glUniform2f(location, x, y);
+}
+
+void Shader::setVec3(int location, const glm::vec3 &value) const{
+    glUniform3fv(location, 1, &value[0]);
+}
+
+void Shader::setVec3(int location, float x, float y, float z) const{
+    glUniform3f(location, x, y, z);
+}
+
+void Shader::setVec4(int location, const glm::vec4 &value) const{
+    glUniform4fv(location, 1, &value[0]);
+}
+
+void Shader::setVec4(int location, float x, float y, float z, float w) const{
+    glUniform4f(location, x, y, z, w);
+}
+
+void Shader::setMat2(int location, const glm::mat2 &mat) const{
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat3(int location, const glm::mat3 &mat) const{
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat4(int location, const glm::mat4 &mat) const{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 }
\ No newline at end of file
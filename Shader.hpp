@@ -6,7 +6,9 @@
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/vector_float3.hpp>
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -16,10 +18,25 @@ class Shader{
     public:
         unsigned int ID;
 
+        // extension of the program binary cache written next to the fragment shader
+        static constexpr const char *PROGRAM_CACHE_EXTENSION{".progcache"};
+
+        // links the program from its cached binary when the sources and driver are unchanged,
+        // from source otherwise
         Shader(const char *vertexPath, const char *fragmentPath);
 
+        // same, with defines (one "#define NAME value" per line) inserted after the #version line of
+        // both stages. Each distinct set of defines gets its own binary cache file.
+        Shader(const char *vertexPath, const char *fragmentPath, const std::string &defines);
+
         void use();
 
+        // returns the location cached at link time, or -1 if the uniform isn't active
+        int getUniformLocation(const std::string &name) const;
+
+        // attaches the named uniform block to a buffer binding point, does nothing if the block isn't active
+        void bindUniformBlock(const std::string &blockName, unsigned int binding) const;
+
         void setBool(const std::string &name, bool value) const;
         void setInt(const std::string &name, int value) const;
         void setFloat(const std::string &name, float value) const;
@@ -32,10 +49,31 @@ class Shader{
         void setMat2(const std::string &name, const glm::mat2 &mat) const;
         void setMat3(const std::string &name, const glm::mat3 &mat) const;
         void setMat4(const std::string &name, const glm::mat4 &mat) const;
-        
-        
 
+        // setters taking a location resolved beforehand with getUniformLocation()
+        void setBool(int location, bool value) const;
+        void setInt(int location, int value) const;
+        void setFloat(int location, float value) const;
+        void setVec2(int location, const glm::vec2 &value) const;
+        void setVec2(int location, float x, float y) const;
+        void setVec3(int location, const glm::vec3 &value) const;
+        void setVec3(int location, float x, float y, float z) const;
+        void setVec4(int location, const glm::vec4 &value) const;
+        void setVec4(int location, float x, float y, float z, float w) const;
+        void setMat2(int location, const glm::mat2 &mat) const;
+        void setMat3(int location, const glm::mat3 &mat) const;
+        void setMat4(int location, const glm::mat4 &mat) const;
+
+    private:
+        // name -> location table for every active uniform of the linked program
+        std::unordered_map<std::string, int> uniformLocations;
+
+        void cacheUniformLocations();
 
+        void compileProgram(const char *vShaderCode, const char *fShaderCode, bool retrievable);
+        // returns false, leaving no program behind, when the cache is missing, stale or rejected
+        bool loadProgramBinary(const std::string &cachePath, uint64_t key);
+        void saveProgramBinary(const std::string &cachePath, uint64_t key) const;
 };
 
 #endif //!_SHADER_HPP
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef SHADER_VARIANTS_HPP
+#define SHADER_VARIANTS_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "Shader.hpp"
+#include "UniformBuffers.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Feature bits of the model shader. Each one becomes a #define of res/model_shader.*, so a variant
+// only contains the lighting paths and texture fetches it actually uses.
+constexpr uint32_t SHADER_DIR_LIGHT{1u << 0};
+constexpr uint32_t SHADER_SPOT_LIGHT{1u << 1};
+constexpr uint32_t SHADER_SPECULAR_MAP{1u << 2};
+// per-instance transform and time zone (see ClockInstances.hpp) instead of the model uniform
+constexpr uint32_t SHADER_INSTANCED{1u << 3};
+// the number of point lights is stored above the flags
+constexpr uint32_t SHADER_POINT_LIGHT_SHIFT{8};
+constexpr uint32_t SHADER_POINT_LIGHT_MASK{0xFFu << SHADER_POINT_LIGHT_SHIFT};
+
+constexpr uint32_t shaderPointLights(int count)
+{
+    return (static_cast<uint32_t>(count) << SHADER_POINT_LIGHT_SHIFT) & SHADER_POINT_LIGHT_MASK;
+}
+
+inline std::string shaderDefines(uint32_t features)
+{
+    std::string defines = "#define NR_POINT_LIGHTS " + std::to_string((features & SHADER_POINT_LIGHT_MASK) >> SHADER_POINT_LIGHT_SHIFT) + "\n";
+    if(features & SHADER_DIR_LIGHT)
+        defines += "#define DIR_LIGHT\n";
+    if(features & SHADER_SPOT_LIGHT)
+        defines += "#define SPOT_LIGHT\n";
+    if(features & SHADER_SPECULAR_MAP)
+        defines += "#define SPECULAR_MAP\n";
+    if(features & SHADER_INSTANCED)
+        defines += "#define INSTANCED\n";
+    return defines;
+}
+
+// the features a material needs from the shader, on top of the scene's lights
+inline uint32_t materialFeatures(const DrawRecord &record)
+{
+    for(uint32_t i = 0; i < record.textureCount; i++)
+    {
+        if(record.textures[i].type == TextureType::Specular)
+            return SHADER_SPECULAR_MAP;
+    }
+    return 0;
+}
+
+// per-object uniforms, applied to whichever variant the object's materials select
+struct ObjectUniforms {
+    glm::mat4 model;
+    float shininess;
+    // ClockPart, the shader rotates the hands from the time of day
+    int hand;
+};
+
+// one compiled variant of the model shader with the locations of its per-object uniforms
+struct ShaderVariant {
+    Shader shader;
+    int model;
+    int materialShininess;
+    // the ClockPart being drawn
+    int hand;
+
+    ShaderVariant(const char *vertexPath, const char *fragmentPath, const std::string &defines)
+        : shader(vertexPath, fragmentPath, defines)
+    {
+        model = shader.getUniformLocation("model");
+        materialShininess = shader.getUniformLocation("material.shininess");
+        hand = shader.getUniformLocation("hand");
+
+        shader.bindUniformBlock("Matrices", MATRICES_BLOCK_BINDING);
+        shader.bindUniformBlock("Lights", LIGHTS_BLOCK_BINDING);
+        shader.bindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+
+        // the samplers never change, point them at their units once
+        shader.use();
+        shader.setInt(shader.getUniformLocation("material.diffuse"), textureUnit(TextureType::Diffuse));
+        shader.setInt(shader.getUniformLocation("material.specular"), textureUnit(TextureType::Specular));
+    }
+};
+
+// The variants of the model shader, compiled on first use and kept for the lifetime of the set.
+// A draw asks for the scene's features combined with its material's (see materialFeatures).
+class ShaderVariants {
+public:
+    ShaderVariants(const char *vertexPath, const char *fragmentPath)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath){}
+
+    ShaderVariants(const ShaderVariants &) = delete;
+    ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+    ShaderVariant &get(uint32_t features)
+    {
+        auto it = variants.find(features);
+        if(it != variants.end())
+            return *it->second;
+
+        std::unique_ptr<ShaderVariant> variant = std::make_unique<ShaderVariant>(vertexPath.c_str(), fragmentPath.c_str(), shaderDefines(features));
+        ShaderVariant &created = *variant;
+        variants.emplace(features, std::move(variant));
+        return created;
+    }
+
+    size_t size() const { return variants.size(); }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderVariant>> variants;
+};
+
+#endif //!_SHADER_VARIANTS_HPP
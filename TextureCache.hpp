@@ -0,0 +1,113 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include "GLState.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// identifies a texture image and how it was loaded
+struct TextureKey {
+    std::string path;   // resolved absolute path
+    bool gamma;         // uploaded as sRGB
+    bool flip;          // flipped vertically on load
+
+    bool operator==(const TextureKey &other) const{
+        return gamma == other.gamma && flip == other.flip && path == other.path;
+    }
+};
+
+struct TextureKeyHash {
+    size_t operator()(const TextureKey &key) const{
+        return std::hash<std::string>()(key.path) ^ (key.gamma ? 0x9e3779b9u : 0u) ^ (key.flip ? 0x7f4a7c15u : 0u);
+    }
+};
+
+// resolves a texture path relative to its model directory into the absolute form used as cache key
+inline std::string resolveTexturePath(const std::string &directory, const std::string &path)
+{
+    std::error_code error;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(std::filesystem::path(directory) / path, error);
+    if(error)
+        return directory + "/" + path;
+    return resolved.string();
+}
+
+// Process-wide, reference-counted cache of GL textures shared by every Model, so an image used by
+// several models is decoded and stored in VRAM once. Lookups are hashed and guarded by a mutex so
+// loaders running on several threads can share it; acquire() creates GL names, so call it with the
+// GL context current.
+class TextureCache{
+
+    public:
+        static TextureCache &instance(){
+            static TextureCache cache;
+            return cache;
+        }
+
+        TextureCache(const TextureCache &) = delete;
+        TextureCache &operator=(const TextureCache &) = delete;
+
+        // returns the texture for key and takes a reference on it. created is set when the texture
+        // didn't exist yet: the caller then owns loading its pixels.
+        unsigned int acquire(const TextureKey &key, bool &created){
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto it = entries.find(key);
+            if(it != entries.end()){
+                it->second.references++;
+                created = false;
+                return it->second.id;
+            }
+
+            Entry entry;
+            glGenTextures(1, &entry.id);
+            entry.references = 1;
+            entries.emplace(key, entry);
+            keys.emplace(entry.id, key);
+            created = true;
+            return entry.id;
+        }
+
+        // drops a reference, the texture is deleted with the last one
+        void release(unsigned int id){
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto keyIt = keys.find(id);
+            if(keyIt == keys.end())
+                return;
+
+            auto it = entries.find(keyIt->second);
+            if(--it->second.references == 0){
+                GLState::instance().forgetTexture(id);
+                glDeleteTextures(1, &id);
+                entries.erase(it);
+                keys.erase(keyIt);
+            }
+        }
+
+        size_t size(){
+            std::lock_guard<std::mutex> lock(mutex);
+            return entries.size();
+        }
+
+    private:
+        struct Entry {
+            unsigned int id = 0;
+            int references = 0;
+        };
+
+        TextureCache() = default;
+
+        std::mutex mutex;
+        std::unordered_map<TextureKey, Entry, TextureKeyHash> entries;
+        std::unordered_map<unsigned int, TextureKey> keys;
+};
+
+#endif //!_TEXTURE_CACHE_HPP
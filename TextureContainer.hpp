@@ -0,0 +1,266 @@
+#ifndef TEXTURE_CONTAINER_HPP
+#define TEXTURE_CONTAINER_HPP
+
+#include "MappedFile.hpp"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Pre-baked texture container, in the spirit of KTX: the whole mip chain stored as RGBA8, ready to be
+// handed to glTexImage2D level by level straight from a memory mapping. It is baked from the source
+// image the first time the image is loaded and keyed on the image content, so the PNG inflate and the
+// driver-side glGenerateMipmap only ever happen once per image.
+//
+// Layout: MipContainerHeader, MipContainerLevel[levelCount], then the levels' RGBA8 pixels.
+
+// bump whenever the layout or the mip filter changes
+constexpr uint32_t MIP_CONTAINER_VERSION{1};
+constexpr char MIP_CONTAINER_MAGIC[8] = {'G', 'L', 'C', 'M', 'I', 'P', 'S', '\0'};
+constexpr const char *MIP_CONTAINER_EXTENSION{".mipcache"};
+
+struct MipContainerHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;         // MIP_FLAG_* the chain was baked with
+    uint64_t sourceHash;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+struct MipContainerLevel {
+    uint64_t offset;        // from the start of the file
+    uint32_t width;
+    uint32_t height;
+};
+
+constexpr uint32_t MIP_FLAG_FLIPPED{1};
+// filtered in linear light, the texels are sRGB encoded
+constexpr uint32_t MIP_FLAG_SRGB{2};
+
+// an RGBA8 mip chain, either baked in memory or mapped from a container
+struct MipChain {
+    struct Level {
+        const unsigned char *data;
+        int width;
+        int height;
+    };
+
+    std::vector<Level> levels;
+
+    MappedFile file;
+    std::vector<unsigned char> pixels;
+
+    bool empty() const { return levels.empty(); }
+};
+
+namespace mipdetail {
+
+    inline float srgbToLinear(float c){
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    inline float linearToSrgb(float c){
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // halves one axis with the 4-tap [1 3 3 1] / 8 filter (a bilinear tent centered between the two
+    // source texels), clamping at the borders. An axis of size 1 is copied through.
+    inline void downsampleAxis(const std::vector<float> &src, int width, int height, bool horizontal, std::vector<float> &dst, int &outWidth, int &outHeight){
+        int length = horizontal ? width : height;
+        int outLength = std::max(1, length / 2);
+        outWidth = horizontal ? outLength : width;
+        outHeight = horizontal ? height : outLength;
+        dst.assign(static_cast<size_t>(outWidth) * outHeight * 4, 0.0f);
+
+        static const float weights[4] = {1.0f / 8.0f, 3.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f};
+        for(int y = 0; y < outHeight; y++){
+            for(int x = 0; x < outWidth; x++){
+                float *out = &dst[(static_cast<size_t>(y) * outWidth + x) * 4];
+                int center = horizontal ? x : y;
+                for(int tap = 0; tap < 4; tap++){
+                    int s = length == 1 ? 0 : std::clamp(center * 2 - 1 + tap, 0, length - 1);
+                    int sx = horizontal ? s : x;
+                    int sy = horizontal ? y : s;
+                    const float *in = &src[(static_cast<size_t>(sy) * width + sx) * 4];
+                    for(int c = 0; c < 4; c++)
+                        out[c] += in[c] * weights[tap];
+                }
+            }
+        }
+    }
+}
+
+// builds the full mip chain of an RGBA8 image into chain.pixels
+inline void buildMipChain(const unsigned char *rgba, int width, int height, bool srgb, MipChain &chain)
+{
+    // level sizes first, so pixels is allocated once and the level pointers stay valid
+    std::vector<std::pair<int, int>> sizes;
+    size_t total = 0;
+    for(int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+    {
+        sizes.push_back({w, h});
+        total += static_cast<size_t>(w) * h * 4;
+        if(w == 1 && h == 1)
+            break;
+    }
+
+    chain.pixels.resize(total);
+    chain.levels.clear();
+    std::memcpy(chain.pixels.data(), rgba, static_cast<size_t>(width) * height * 4);
+
+    // filter in float, in linear light for sRGB content
+    std::vector<float> current(static_cast<size_t>(width) * height * 4);
+    for(size_t i = 0; i < current.size(); i++)
+    {
+        float value = rgba[i] / 255.0f;
+        current[i] = (srgb && i % 4 != 3) ? mipdetail::srgbToLinear(value) : value;
+    }
+
+    size_t offset = 0;
+    std::vector<float> temp;
+    int w = width;
+    int h = height;
+    for(size_t level = 0; level < sizes.size(); level++)
+    {
+        unsigned char *out = chain.pixels.data() + offset;
+        chain.levels.push_back({out, sizes[level].first, sizes[level].second});
+        offset += static_cast<size_t>(sizes[level].first) * sizes[level].second * 4;
+
+        if(level == 0)
+            continue;
+
+        int tw, th;
+        mipdetail::downsampleAxis(current, w, h, true, temp, tw, th);
+        mipdetail::downsampleAxis(temp, tw, th, false, current, w, h);
+
+        for(size_t i = 0; i < current.size(); i++)
+        {
+            float value = (srgb && i % 4 != 3) ? mipdetail::linearToSrgb(current[i]) : current[i];
+            out[i] = static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+// maps a container and checks it was baked from this source with these settings
+inline bool loadMipContainer(const std::string &containerPath, uint64_t sourceHash, uint32_t flags, MipChain &chain)
+{
+    if(!chain.file.open(containerPath))
+        return false;
+
+    const unsigned char *base = chain.file.data();
+    size_t size = chain.file.size();
+
+    MipContainerHeader header;
+    if(size < sizeof(header))
+        return false;
+    std::memcpy(&header, base, sizeof(header));
+    if(std::memcmp(header.magic, MIP_CONTAINER_MAGIC, sizeof(MIP_CONTAINER_MAGIC)) != 0
+        || header.version != MIP_CONTAINER_VERSION
+        || header.sourceHash != sourceHash
+        || header.flags != flags
+        || size < sizeof(header) + header.levelCount * sizeof(MipContainerLevel))
+    {
+        chain.file.close();
+        return false;
+    }
+
+    chain.levels.clear();
+    for(uint32_t i = 0; i < header.levelCount; i++)
+    {
+        MipContainerLevel level;
+        std::memcpy(&level, base + sizeof(header) + i * sizeof(MipContainerLevel), sizeof(level));
+        if(level.offset + static_cast<uint64_t>(level.width) * level.height * 4 > size)
+        {
+            chain.levels.clear();
+            chain.file.close();
+            return false;
+        }
+        chain.levels.push_back({base + level.offset, static_cast<int>(level.width), static_cast<int>(level.height)});
+    }
+    return !chain.levels.empty();
+}
+
+// writes a container, renamed into place only once complete
+inline bool writeMipContainer(const std::string &containerPath, uint64_t sourceHash, uint32_t flags, const MipChain &chain)
+{
+    std::string tempPath = containerPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if(!out)
+    {
+        std::cout << "ERROR::MIP_CONTAINER::CANNOT_WRITE " << tempPath << std::endl;
+        return false;
+    }
+
+    MipContainerHeader header;
+    std::memcpy(header.magic, MIP_CONTAINER_MAGIC, sizeof(MIP_CONTAINER_MAGIC));
+    header.version = MIP_CONTAINER_VERSION;
+    header.flags = flags;
+    header.sourceHash = sourceHash;
+    header.width = chain.levels[0].width;
+    header.height = chain.levels[0].height;
+    header.levelCount = static_cast<uint32_t>(chain.levels.size());
+    header.reserved = 0;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(header) + chain.levels.size() * sizeof(MipContainerLevel);
+    for(const MipChain::Level &level : chain.levels)
+    {
+        MipContainerLevel entry{offset, static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height)};
+        out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        offset += static_cast<uint64_t>(level.width) * level.height * 4;
+    }
+    for(const MipChain::Level &level : chain.levels)
+        out.write(reinterpret_cast<const char *>(level.data), static_cast<size_t>(level.width) * level.height * 4);
+
+    out.close();
+    if(!out || std::rename(tempPath.c_str(), containerPath.c_str()) != 0)
+    {
+        std::cout << "ERROR::MIP_CONTAINER::CANNOT_WRITE " << containerPath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Loads the mip chain of an image: from its container when it is up to date, otherwise by decoding
+// the image, baking the chain and writing a fresh container for the next start. Safe on any thread.
+inline bool loadMipChain(const std::string &imagePath, bool flip, bool srgb, MipChain &chain)
+{
+    uint64_t sourceHash{0};
+    if(!hashFile(imagePath, sourceHash))
+    {
+        std::cout << "Texture failed to load at: " << imagePath << std::endl;
+        return false;
+    }
+
+    uint32_t flags = (flip ? MIP_FLAG_FLIPPED : 0) | (srgb ? MIP_FLAG_SRGB : 0);
+    std::string containerPath = imagePath + MIP_CONTAINER_EXTENSION;
+    if(loadMipContainer(containerPath, sourceHash, flags, chain))
+        return true;
+
+    int width, height, nrComponents;
+    stbi_set_flip_vertically_on_load_thread(flip);
+    unsigned char *rgba = stbi_load(imagePath.c_str(), &width, &height, &nrComponents, 4);
+    if(!rgba)
+    {
+        std::cout << "Texture failed to load at: " << imagePath << std::endl;
+        return false;
+    }
+    buildMipChain(rgba, width, height, srgb, chain);
+    stbi_image_free(rgba);
+
+    writeMipContainer(containerPath, sourceHash, flags, chain);
+    return true;
+}
+
+#endif //!_TEXTURE_CONTAINER_HPP
@@ -0,0 +1,92 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include "GLState.hpp"
+#include "TextureCache.hpp"
+#include "TextureContainer.hpp"
+#include "Trace.hpp"
+
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Uploads a pre-built mip chain into textureID level by level straight from its memory (usually a
+// mapped container), no mip generation on the driver side, and sets the default sampling parameters.
+// With gamma the color channels are stored as sRGB so sampling returns linear values. GL thread only.
+inline void uploadMipChain(unsigned int textureID, const MipChain &chain, bool gamma = false)
+{
+    GLState::instance().bindTexture(0, textureID);
+
+    if (!chain.empty())
+    {
+        GLenum internalFormat = gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (size_t level = 0; level < chain.levels.size(); level++)
+        {
+            const MipChain::Level &mip = chain.levels[level];
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.data);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(chain.levels.size()) - 1);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// The mip chains of the textures requested by models loading at the same time. Each image is mapped
+// (or baked) by the first thread asking for it, the others wait for that result instead of loading
+// it again. Safe to use from any thread, never touches GL.
+class MipChainRequests{
+
+    public:
+        MipChainRequests() = default;
+
+        MipChainRequests(const MipChainRequests &) = delete;
+        MipChainRequests &operator=(const MipChainRequests &) = delete;
+
+        std::shared_ptr<const MipChain> get(const TextureKey &key){
+            std::promise<std::shared_ptr<const MipChain>> promise;
+            std::shared_future<std::shared_ptr<const MipChain>> result;
+            bool owner{false};
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = requests.find(key);
+                if(it == requests.end()){
+                    result = promise.get_future().share();
+                    requests.emplace(key, result);
+                    owner = true;
+                } else {
+                    result = it->second;
+                }
+            }
+
+            if(owner){
+                TRACE_SCOPE_DETAIL("texture decode", key.path);
+                std::shared_ptr<MipChain> chain = std::make_shared<MipChain>();
+                loadMipChain(key.path, key.flip, key.gamma, *chain);
+                promise.set_value(std::move(chain));
+            }
+            return result.get();
+        }
+
+        // drops the chains once every model using them has been uploaded
+        void clear(){
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.clear();
+        }
+
+    private:
+        std::mutex mutex;
+        std::unordered_map<TextureKey, std::shared_future<std::shared_ptr<const MipChain>>, TextureKeyHash> requests;
+};
+
+#endif //!_TEXTURE_LOADER_HPP
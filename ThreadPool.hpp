@@ -0,0 +1,145 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for CPU-side loading work (decoding, importing). Never touches GL.
+class ThreadPool{
+
+    public:
+        explicit ThreadPool(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency())) : stopping(false){
+            for(unsigned int i = 0; i < threadCount; i++){
+                workers.emplace_back([this]{ workerLoop(); });
+            }
+        }
+
+        ~ThreadPool(){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeUp.notify_all();
+            for(std::thread &worker : workers){
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // pool shared by all loaders of the process
+        static ThreadPool &shared(){
+            static ThreadPool pool;
+            return pool;
+        }
+
+        unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+        // queues a task and returns a future for its result
+        template<typename Function>
+        auto submit(Function function) -> std::future<decltype(function())>{
+            using Result = decltype(function());
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([task]{ (*task)(); });
+            }
+            wakeUp.notify_one();
+            return result;
+        }
+
+        // runs body(i) for every i in [0, count) and waits for all of them.
+        // The calling thread takes part in the work, so it is safe to call from inside a pool task.
+        // If a body throws, the other indices still run and the first exception is rethrown here.
+        void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body){
+            if(count == 0){
+                return;
+            }
+            if(count == 1){
+                body(0);
+                return;
+            }
+
+            // helpers that start after every index was claimed return without touching body,
+            // so the caller only waits for claimed work and never for queued helpers
+            struct Progress {
+                std::atomic<std::size_t> next{0};
+                std::size_t done{0};
+                std::exception_ptr error;
+                std::mutex mutex;
+                std::condition_variable finished;
+            };
+            auto progress = std::make_shared<Progress>();
+            const std::function<void(std::size_t)> *work = &body;
+            auto run = [progress, count, work]{
+                for(std::size_t i = progress->next++; i < count; i = progress->next++){
+                    // a throwing index still counts as done, or the caller would wait forever
+                    std::exception_ptr error;
+                    try{
+                        (*work)(i);
+                    } catch(...){
+                        error = std::current_exception();
+                    }
+                    std::lock_guard<std::mutex> lock(progress->mutex);
+                    if(error && !progress->error){
+                        progress->error = error;
+                    }
+                    if(++progress->done == count){
+                        progress->finished.notify_all();
+                    }
+                }
+            };
+
+            std::size_t helpers = std::min<std::size_t>(workers.size(), count - 1);
+            for(std::size_t i = 0; i < helpers; i++){
+                submit(run);
+            }
+            run();
+
+            std::unique_lock<std::mutex> lock(progress->mutex);
+            progress->finished.wait(lock, [&progress, count]{ return progress->done == count; });
+            if(progress->error){
+                std::rethrow_exception(progress->error);
+            }
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool stopping;
+
+        void workerLoop(){
+            TRACE_THREAD_NAME("pool worker");
+            while(true){
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wakeUp.wait(lock, [this]{ return stopping || !tasks.empty(); });
+                    if(stopping && tasks.empty()){
+                        return;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+};
+
+#endif //!_THREAD_POOL_HPP
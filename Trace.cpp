@@ -0,0 +1,178 @@
+#include "Trace.hpp"
+
+#include <iostream>
+
+#ifdef GLCLOCK_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+    struct TraceEvent {
+        const char *name;
+        std::string detail;
+        uint64_t start;
+        uint64_t duration;
+        uint32_t thread;
+        // instant events have no duration
+        bool instant;
+    };
+
+    struct TraceThread {
+        uint32_t id;
+        const char *name;
+    };
+
+    // captured during static initialization, as close to the process start as we get without
+    // asking the OS
+    const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+    std::mutex traceMutex;
+    std::vector<TraceEvent> events;
+    std::vector<TraceThread> threadNames;
+    std::atomic<bool> recording{true};
+    std::atomic<uint32_t> nextThread{1};
+
+    uint32_t threadId(){
+        thread_local uint32_t id = nextThread++;
+        return id;
+    }
+
+    void writeEscaped(std::ostream &out, const char *text, size_t length){
+        for(size_t i = 0; i < length; i++){
+            char c = text[i];
+            if(c == '"' || c == '\\'){
+                out << '\\' << c;
+            } else if(static_cast<unsigned char>(c) < 0x20){
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+    }
+
+}
+
+uint64_t Trace::now(){
+
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processStart).count());
+
+}
+
+void Trace::record(const char *name, const std::string &detail, uint64_t start, uint64_t end){
+
+    if(!recording.load(std::memory_order_relaxed)){
+        return;
+    }
+
+    uint32_t thread = threadId();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    events.push_back({name, detail, start, end - start, thread, false});
+
+}
+
+void Trace::instant(const char *name){
+
+    if(!recording.load(std::memory_order_relaxed)){
+        return;
+    }
+
+    uint64_t time = now();
+    uint32_t thread = threadId();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    events.push_back({name, std::string(), time, 0, thread, true});
+
+}
+
+void Trace::setThreadName(const char *name){
+
+    uint32_t thread = threadId();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    threadNames.push_back({thread, name});
+
+}
+
+bool Trace::isCompiledIn(){
+
+    return true;
+
+}
+
+bool Trace::write(const std::string &path){
+
+    recording = false;
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    std::ofstream out(path, std::ios::trunc);
+    if(!out){
+        std::cout << "ERROR::TRACE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    // complete ("X") and instant ("i") events, one process, one track per thread
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first{true};
+    for(const TraceThread &thread : threadNames){
+        out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread.id << ",\"args\":{\"name\":\"";
+        writeEscaped(out, thread.name, std::char_traits<char>::length(thread.name));
+        out << "\"}}";
+        first = false;
+    }
+    for(const TraceEvent &event : events){
+        out << (first ? "" : ",\n") << "{\"ph\":\"" << (event.instant ? 'i' : 'X') << "\",\"name\":\"";
+        writeEscaped(out, event.name, std::char_traits<char>::length(event.name));
+        out << "\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start;
+        if(event.instant){
+            // a marker across the whole process
+            out << ",\"s\":\"p\"";
+        } else {
+            out << ",\"dur\":" << event.duration;
+        }
+        if(!event.detail.empty()){
+            out << ",\"args\":{\"detail\":\"";
+            writeEscaped(out, event.detail.data(), event.detail.size());
+            out << "\"}";
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+
+    out.close();
+    if(!out){
+        std::cout << "ERROR::TRACE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    std::cout << "Trace: " << events.size() << " events written to " << path << std::endl;
+    events.clear();
+    return true;
+
+}
+
+#else
+
+void Trace::setThreadName(const char *){
+
+}
+
+bool Trace::isCompiledIn(){
+
+    return false;
+
+}
+
+bool Trace::write(const std::string &path){
+
+    std::cout << "ERROR::TRACE::NOT_COMPILED_IN rebuild with -DGLCLOCK_TRACE=ON to write " << path << std::endl;
+    return false;
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// Startup trace in the Chrome trace-event format (open it in Perfetto or chrome://tracing).
+//
+// Spans are opened with TRACE_SCOPE / TRACE_SCOPE_DETAIL and closed at the end of the enclosing
+// scope, on any thread; TRACE_INSTANT marks a single moment. They are only compiled in with
+// GLCLOCK_TRACE defined (cmake -DGLCLOCK_TRACE=ON); without it the macros expand to nothing and their
+// arguments are never evaluated. Timestamps count from the process start, so the trace covers
+// everything up to the first frame presented with every model loaded.
+class Trace{
+
+    public:
+        // writes every span recorded so far and stops recording, returns false if the file couldn't
+        // be written or tracing isn't compiled in
+        static bool write(const std::string &path);
+
+        // names the calling thread in the trace, names must outlive the trace
+        static void setThreadName(const char *name);
+
+        static bool isCompiledIn();
+
+#ifdef GLCLOCK_TRACE
+        // microseconds since the process start
+        static uint64_t now();
+        static void record(const char *name, const std::string &detail, uint64_t start, uint64_t end);
+        // an event without duration, at the current time
+        static void instant(const char *name);
+#endif
+};
+
+#ifdef GLCLOCK_TRACE
+
+// a span of the trace, from construction to destruction
+class TraceSpan{
+
+    public:
+        explicit TraceSpan(const char *name) : name(name), start(Trace::now()){}
+        TraceSpan(const char *name, std::string detail) : name(name), detail(std::move(detail)), start(Trace::now()){}
+
+        ~TraceSpan(){
+            Trace::record(name, detail, start, Trace::now());
+        }
+
+        TraceSpan(const TraceSpan &) = delete;
+        TraceSpan &operator=(const TraceSpan &) = delete;
+
+    private:
+        const char *name;
+        std::string detail;
+        uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// name must be a string literal, detail (e.g. a file name) is copied
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SCOPE_DETAIL(name, detail) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, detail)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#define TRACE_INSTANT(name) Trace::instant(name)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_DETAIL(name, detail) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+
+#endif
+
+#endif //!_TRACE_HPP
@@ -0,0 +1,166 @@
+#ifndef UNIFORM_BUFFERS_HPP
+#define UNIFORM_BUFFERS_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// capacity of the Lights block, shader variants declare at most this many point lights
+constexpr int NR_POINT_LIGHTS{3};
+
+// binding points shared by every shader that declares the blocks
+constexpr unsigned int MATRICES_BLOCK_BINDING{0};
+constexpr unsigned int LIGHTS_BLOCK_BINDING{1};
+constexpr unsigned int FRAME_BLOCK_BINDING{2};
+
+// std140 mirror of the "Matrices" uniform block
+struct MatricesBlock {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float padding;
+};
+
+// std140 mirror of the "Frame" block: what changes every frame, kept apart so the matrices
+// are only re-uploaded when the camera moves or the window is resized
+struct FrameBlock {
+    // local time of day in seconds
+    float timeOfDay;
+    float padding[3];
+};
+
+// std140 mirror of the PointLight struct: every vec3 shares its 16 byte slot with the following float
+struct PointLightBlock {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding;
+};
+
+// std140 mirror of the "Lights" uniform block
+struct LightsBlock {
+    PointLightBlock pointLights[NR_POINT_LIGHTS];
+};
+
+static_assert(sizeof(MatricesBlock) == 144, "MatricesBlock must follow the std140 layout");
+static_assert(sizeof(FrameBlock) == 16, "FrameBlock must follow the std140 layout");
+static_assert(sizeof(PointLightBlock) == 64, "PointLightBlock must follow the std140 layout");
+
+// Owns the uniform buffer objects holding the per-scene data (camera matrices, lights and time).
+// Blocks are only re-uploaded when their contents have been marked dirty.
+class UniformBuffers{
+
+    public:
+        UniformBuffers() : matricesUBO(0), lightsUBO(0), frameUBO(0), matricesDirty(true), lightsDirty(true), frameDirty(true), uploads(0){
+            matrices = MatricesBlock{glm::mat4(1.0f), glm::mat4(1.0f), glm::vec3(0.0f), 0.0f};
+            lights = LightsBlock{};
+            frame = FrameBlock{};
+        }
+
+        ~UniformBuffers(){
+            if(matricesUBO != 0){
+                glDeleteBuffers(1, &matricesUBO);
+                glDeleteBuffers(1, &lightsUBO);
+                glDeleteBuffers(1, &frameUBO);
+            }
+        }
+
+        UniformBuffers(const UniformBuffers &) = delete;
+        UniformBuffers &operator=(const UniformBuffers &) = delete;
+
+        // creates the buffers and attaches them to their binding points (needs a current GL context)
+        void init(){
+            glGenBuffers(1, &matricesUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, matricesUBO);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(MatricesBlock), nullptr, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, MATRICES_BLOCK_BINDING, matricesUBO);
+
+            glGenBuffers(1, &lightsUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsBlock), nullptr, GL_STATIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, lightsUBO);
+
+            glGenBuffers(1, &frameUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, frameUBO);
+
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        void setMatrices(const glm::mat4 &projection, const glm::mat4 &view, const glm::vec3 &viewPos){
+            matrices.projection = projection;
+            matrices.view = view;
+            matrices.viewPos = viewPos;
+            matricesDirty = true;
+        }
+
+        // the clock time the hands are rotated to by the vertex shader
+        void setTimeOfDay(float seconds){
+            if(frame.timeOfDay != seconds){
+                frame.timeOfDay = seconds;
+                frameDirty = true;
+            }
+        }
+
+        void setPointLight(int index, const PointLightBlock &light){
+            lights.pointLights[index] = light;
+            lightsDirty = true;
+        }
+
+        void markMatricesDirty(){ matricesDirty = true; }
+        void markLightsDirty(){ lightsDirty = true; }
+
+        // uploads every dirty block, returns how many blocks were sent to the GPU
+        int upload(){
+            int count{0};
+            if(matricesDirty){
+                uploadBlock(matricesUBO, &matrices, sizeof(MatricesBlock));
+                matricesDirty = false;
+                count++;
+            }
+            if(lightsDirty){
+                uploadBlock(lightsUBO, &lights, sizeof(LightsBlock));
+                lightsDirty = false;
+                count++;
+            }
+            if(frameDirty){
+                uploadBlock(frameUBO, &frame, sizeof(FrameBlock));
+                frameDirty = false;
+                count++;
+            }
+            uploads += count;
+            return count;
+        }
+
+        // total number of block uploads since creation
+        unsigned long getUploadCount() const { return uploads; }
+
+    private:
+        unsigned int matricesUBO;
+        unsigned int lightsUBO;
+        unsigned int frameUBO;
+
+        MatricesBlock matrices;
+        LightsBlock lights;
+        FrameBlock frame;
+
+        bool matricesDirty;
+        bool lightsDirty;
+        bool frameDirty;
+        unsigned long uploads;
+
+        void uploadBlock(unsigned int ubo, const void *data, std::size_t size){
+            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+};
+
+#endif //!_UNIFORM_BUFFERS_HPP
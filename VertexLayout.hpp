@@ -0,0 +1,113 @@
+#ifndef VERTEX_LAYOUT_HPP
+#define VERTEX_LAYOUT_HPP
+
+#include "glad/include/glad/glad.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#define MAX_BONE_INFLUENCE 4
+
+// Full-precision vertex produced by the importers. It is what the loaders, the mesh cache
+// and the mesh processing passes work on; the GPU only sees it through a VertexLayout.
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+	//bone indexes which will influence this vertex
+	int m_BoneIDs[MAX_BONE_INFLUENCE];
+	//weights from each bone
+	float m_Weights[MAX_BONE_INFLUENCE];
+};
+
+// one glVertexAttribPointer call worth of description
+struct VertexAttribute {
+    unsigned int location;
+    int components;
+    GLenum type;
+    GLboolean normalized;
+    // integer attributes go through glVertexAttribIPointer
+    bool integer;
+    size_t offset;
+};
+
+// A vertex layout describes how a Vertex is stored in a vertex buffer:
+//   Packed      the per-vertex struct uploaded to the GPU
+//   attributes  the attribute pointers to set up for Packed
+//   pack()      converts an imported Vertex to Packed
+
+// Every field of Vertex, 88 bytes. Needed only by shaders doing normal mapping or skinning.
+struct FullVertexLayout {
+    using Packed = Vertex;
+
+    static constexpr VertexAttribute attributes[] = {
+        {0, 3, GL_FLOAT, GL_FALSE, false, offsetof(Vertex, Position)},
+        {1, 3, GL_FLOAT, GL_FALSE, false, offsetof(Vertex, Normal)},
+        {2, 2, GL_FLOAT, GL_FALSE, false, offsetof(Vertex, TexCoords)},
+        {3, 3, GL_FLOAT, GL_FALSE, false, offsetof(Vertex, Tangent)},
+        {4, 3, GL_FLOAT, GL_FALSE, false, offsetof(Vertex, Bitangent)},
+        {5, 4, GL_INT, GL_FALSE, true, offsetof(Vertex, m_BoneIDs)},
+        {6, 4, GL_FLOAT, GL_FALSE, false, offsetof(Vertex, m_Weights)},
+    };
+
+    static Packed pack(const Vertex &vertex){ return vertex; }
+};
+
+// Position, normal and texture coordinates at full precision, 32 bytes.
+struct StandardVertexLayout {
+    struct Packed {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texCoords;
+    };
+
+    static constexpr VertexAttribute attributes[] = {
+        {0, 3, GL_FLOAT, GL_FALSE, false, offsetof(Packed, position)},
+        {1, 3, GL_FLOAT, GL_FALSE, false, offsetof(Packed, normal)},
+        {2, 2, GL_FLOAT, GL_FALSE, false, offsetof(Packed, texCoords)},
+    };
+
+    static Packed pack(const Vertex &vertex){
+        return Packed{vertex.Position, vertex.Normal, vertex.TexCoords};
+    }
+};
+
+// What res/model_shader.vs actually reads, 20 bytes: float position,
+// normal packed as GL_INT_2_10_10_10_REV and half-float texture coordinates.
+// Half floats keep ~11 bits of mantissa, plenty for UVs in [0, 1].
+struct CompactVertexLayout {
+    struct Packed {
+        glm::vec3 position;
+        uint32_t normal;
+        uint32_t texCoords;
+    };
+
+    static constexpr VertexAttribute attributes[] = {
+        {0, 3, GL_FLOAT, GL_FALSE, false, offsetof(Packed, position)},
+        {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, false, offsetof(Packed, normal)},
+        {2, 2, GL_HALF_FLOAT, GL_FALSE, false, offsetof(Packed, texCoords)},
+    };
+
+    static Packed pack(const Vertex &vertex){
+        return Packed{vertex.Position, glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f)), glm::packHalf2x16(vertex.TexCoords)};
+    }
+};
+
+static_assert(sizeof(FullVertexLayout::Packed) == 88, "unexpected padding in Vertex");
+static_assert(sizeof(StandardVertexLayout::Packed) == 32, "unexpected padding in StandardVertexLayout");
+static_assert(sizeof(CompactVertexLayout::Packed) == 20, "unexpected padding in CompactVertexLayout");
+
+// layout used by Model; switch it here to trade memory for precision or extra attributes
+using DefaultVertexLayout = CompactVertexLayout;
+
+#endif //!_VERTEX_LAYOUT_HPP
@@ -11,6 +11,7 @@
 #include <SDL3/SDL_stdinc.h>
 #include <SDL3/SDL_timer.h>
 #include <SDL3/SDL_video.h>
+#include <chrono>
 #include <ctime>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/vector_float3.hpp>
@@ -24,6 +25,12 @@
 #include "glad/include/glad/glad.h"
 
 #include <glm/trigonometric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 
 glClockpp::glClockpp(){
@@ -42,8 +49,7 @@ glClockpp::glClockpp(){
     //initialize time variables
     hours = 0;
     minutes = 0;
-    hourAngle = 0.0f;
-    minuteAngle = 0.0f;
+    smoothHands = true;
 
     //initialize window
     gWindow = nullptr;
@@ -51,8 +57,22 @@ glClockpp::glClockpp(){
 
     window_Width = 4;
     window_Height = 3;
+    projectionDirty = true;
+    sceneFeatures = 0;
+
+    forcedLod = -1;
+    wallLod = 0;
 
     SDL_zero(event);
+
+    //register the profiled phases, they cost nothing until the profiler is enabled
+    phases.events = profiler.addPhase("event pump", false);
+    phases.uniforms = profiler.addPhase("uniform setup", false);
+    phases.clockDraw = profiler.addPhase("clock draw", true);
+    phases.hoursDraw = profiler.addPhase("hours hand draw", true);
+    phases.minutesDraw = profiler.addPhase("minutes hand draw", true);
+    phases.glassDraw = profiler.addPhase("glass draw", true);
+    phases.swap = profiler.addPhase("swap", false);
 }
 
 glClockpp::~glClockpp(){
@@ -63,15 +83,30 @@ bool glClockpp::initializeSDL(){
 
     bool success{true};
 
-    if(SDL_Init(SDL_INIT_VIDEO) == false){
+    bool initialized;
+    {
+        TRACE_SCOPE("SDL video init");
+        initialized = SDL_Init(SDL_INIT_VIDEO);
+    }
+
+    if(initialized == false){
         SDL_Log("SDL couldt not initialize! SDL error: %s\n", SDL_GetError());
         success = false;
     } else {
-        if(SDL_CreateWindowAndRenderer("Initializing glClock++ - v0.2 Beta - (c)2025 Matías Saibene", SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE, &gWindow, &gRenderer) == false){
+        bool created;
+        {
+            TRACE_SCOPE("SDL_CreateWindowAndRenderer");
+            created = SDL_CreateWindowAndRenderer("Initializing glClock++ - v0.2 Beta - (c)2025 Matías Saibene", SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE, &gWindow, &gRenderer);
+        }
+
+        if(created == false){
             SDL_Log( "Window could not be created! SDL error: %s\n", SDL_GetError() );
             success = false;
         } else {
-            ctx = SDL_GL_CreateContext(gWindow);
+            {
+                TRACE_SCOPE("SDL_GL_CreateContext");
+                ctx = SDL_GL_CreateContext(gWindow);
+            }
             if(!ctx){
                 SDL_Log("GL Context error: %s\n", SDL_GetError());
                 success = false;
@@ -90,111 +125,448 @@ bool glClockpp::initializeSDL(){
 
 }
 
+bool glClockpp::initializeHeadless(int width, int height){
+
+    TRACE_SCOPE("headless context");
+    if(headless.initialize(width, height) == false){
+        SDL_Log("Headless context could not be created!\n");
+        return false;
+    }
+
+    return true;
+
+}
+
+bool parseOptions(int argc, char *argv[], RunOptions &options){
+
+    for(int i = 1; i < argc; i++){
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(std::strcmp(arg, "--headless") == 0){
+            options.headless = true;
+        } else if(std::strcmp(arg, "--width") == 0 && hasValue){
+            options.width = std::atoi(argv[++i]);
+        } else if(std::strcmp(arg, "--height") == 0 && hasValue){
+            options.height = std::atoi(argv[++i]);
+        } else if(std::strcmp(arg, "--frames") == 0 && hasValue){
+            options.frames = std::atoi(argv[++i]);
+        } else if(std::strcmp(arg, "--dump") == 0 && hasValue){
+            options.dumpDir = argv[++i];
+        } else if(std::strcmp(arg, "--profile") == 0){
+            options.profile = true;
+        } else if(std::strcmp(arg, "--idle") == 0){
+            options.idle = true;
+        } else if(std::strcmp(arg, "--fps") == 0 && hasValue){
+            options.fps = std::atof(argv[++i]);
+        } else if(std::strcmp(arg, "--swap") == 0 && hasValue && FramePacer::parseSwapMode(argv[i + 1], options.swapMode)){
+            i++;
+        } else if(std::strcmp(arg, "--clocks") == 0 && hasValue){
+            options.clocks = std::atoi(argv[++i]);
+        } else if(std::strcmp(arg, "--bench-clocks") == 0){
+            options.benchClocks = true;
+        } else if(std::strcmp(arg, "--check-allocs") == 0){
+            options.checkAllocs = true;
+        } else if(std::strcmp(arg, "--trace") == 0 && hasValue){
+            options.tracePath = argv[++i];
+        } else if(std::strcmp(arg, "--assimp") == 0){
+            options.assimp = true;
+        } else if(std::strcmp(arg, "--bench-obj") == 0 && hasValue){
+            options.benchObj = argv[++i];
+        } else if(std::strcmp(arg, "--lod") == 0 && hasValue){
+            options.lod = std::atoi(argv[++i]);
+        } else if(std::strcmp(arg, "--keep-geometry") == 0){
+            options.keepGeometry = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--headless] [--width W] [--height H] [--frames N] [--dump DIR] [--profile] [--idle] [--fps N] [--swap vsync|adaptive|off] [--clocks N] [--bench-clocks] [--check-allocs] [--trace FILE] [--assimp] [--bench-obj FILE] [--lod N] [--keep-geometry]" << std::endl;
+            return false;
+        }
+    }
+
+    if(!options.tracePath.empty() && !Trace::isCompiledIn()){
+        std::cout << "--trace needs a build with -DGLCLOCK_TRACE=ON" << std::endl;
+        return false;
+    }
+
+    if(options.checkAllocs && !options.headless){
+        std::cout << "--check-allocs needs --headless" << std::endl;
+        return false;
+    }
+
+    if(options.frames <= 0){
+        std::cout << "Invalid frame count " << options.frames << std::endl;
+        return false;
+    }
+
+    if(options.width <= 0 || options.height <= 0){
+        std::cout << "Invalid resolution " << options.width << "x" << options.height << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// renders a fixed number of frames offscreen and reports the throughput
+static int runHeadless(glClockpp &glClock, const RunOptions &options, ShaderVariants &modelShaders, Model &clockModel, Model &hourHand, Model &minutesHand, Model &glassCover){
+
+    HeadlessContext &headless = glClock.getHeadless();
+    FrameProfiler &profiler = glClock.getProfiler();
+    char framePath[512];
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 LAST = start;
+
+    int allocatingFrames{0};
+    uint64_t worstAllocations{0};
+
+    // time spent writing the trace and the frame dumps, left out of the reported frame time
+    Uint64 excluded{0};
+    Uint64 dumping{0};
+
+    for(int frame = 0; frame < options.frames; frame++){
+
+        bool countAllocations = options.checkAllocs && frame >= ALLOCATION_CHECK_WARMUP;
+        if(countAllocations){
+            AllocationCounter::begin();
+        }
+
+        profiler.beginFrame();
+        GLState::instance().beginFrame();
+
+        Uint64 NOW = SDL_GetPerformanceCounter();
+        glClock.setDeltaTime((double)(NOW - LAST) / (double)SDL_GetPerformanceFrequency());
+        LAST = NOW;
+
+        glClearColor(0.06301f, 0.024157f, 0.283149f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        if(options.clocks > 0){
+            glClock.drawClockWall(modelShaders, clockModel, hourHand, minutesHand, glassCover);
+        } else {
+            glClock.drawGirodNormal(modelShaders, clockModel, hourHand, minutesHand, glassCover);
+        }
+
+        profiler.endFrame();
+        GLState::instance().endFrame();
+
+        // headless frames are never presented, the trace ends once the first one is rendered
+        if(frame == 0 && !options.tracePath.empty()){
+            {
+                TRACE_SCOPE("first frame finish");
+                glFinish();
+            }
+            TRACE_INSTANT("first rendered frame");
+            Uint64 writeStart = SDL_GetPerformanceCounter();
+            Trace::write(options.tracePath);
+            excluded += SDL_GetPerformanceCounter() - writeStart;
+        }
+
+        if(countAllocations){
+            uint64_t allocations = AllocationCounter::end();
+            if(allocations > 0){
+                if(allocatingFrames == 0){
+                    std::cout << "ERROR::FRAME::HEAP_ALLOCATION frame " << frame << " made " << allocations << " allocations" << std::endl;
+                }
+                allocatingFrames++;
+                worstAllocations = std::max(worstAllocations, allocations);
+            }
+        }
+
+        // the frame dump is a debugging aid, not part of the counted frame: its allocations
+        // come after the count above ends, and its time is kept out of the frame time
+        if(!options.dumpDir.empty()){
+            // the frame's rendering still counts, only the readback and the file write don't
+            glFinish();
+            Uint64 dumpStart = SDL_GetPerformanceCounter();
+            std::snprintf(framePath, sizeof(framePath), "%s/frame_%04d.ppm", options.dumpDir.c_str(), frame);
+            headless.dumpFrame(framePath);
+            dumping += SDL_GetPerformanceCounter() - dumpStart;
+        }
+    }
+
+    // wait for the GPU so the measurement covers the rendering, not just the submission
+    glFinish();
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    double seconds = (double)(SDL_GetPerformanceCounter() - start - excluded - dumping) / frequency;
+
+    std::cout << "Headless: " << options.frames << " frames at " << options.width << "x" << options.height
+              << " in " << seconds << " s (" << (seconds * 1000.0 / options.frames) << " ms/frame, "
+              << (options.frames / seconds) << " fps)" << std::endl;
+    if(dumping > 0){
+        std::cout << "Frame dumps: " << (dumping / frequency) << " s, not included above" << std::endl;
+    }
+
+    profiler.report(std::cout);
+    GLState::instance().report(std::cout);
+
+    if(options.checkAllocs){
+        int checked = std::max(0, options.frames - ALLOCATION_CHECK_WARMUP);
+        std::cout << "Allocation check: " << allocatingFrames << " of " << checked << " frames allocated";
+        if(allocatingFrames > 0){
+            std::cout << " (worst " << worstAllocations << ")" << std::endl;
+            return 1;
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
+
+// renders the instanced clock wall at increasing sizes and reports the frame time of each
+static int runClockWallBenchmark(glClockpp &glClock, const RunOptions &options, ShaderVariants &modelShaders, Model &clockModel, Model &hourHand, Model &minutesHand, Model &glassCover){
+
+    const size_t counts[] = {1, 100, 1000, 10000};
+
+    std::cout << "Clock wall benchmark, " << options.frames << " frames per size:" << std::endl;
+    for(size_t count : counts){
+        glClock.setupClockWall(count, clockModel, hourHand, minutesHand, glassCover);
+
+        // one untimed frame compiles the variants and uploads the instances
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClock.drawClockWall(modelShaders, clockModel, hourHand, minutesHand, glassCover);
+        glFinish();
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int frame = 0; frame < options.frames; frame++){
+            glClearColor(0.06301f, 0.024157f, 0.283149f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glClock.drawClockWall(modelShaders, clockModel, hourHand, minutesHand, glassCover);
+        }
+        glFinish();
+        double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+        std::cout << std::setw(8) << count << " clocks: " << std::fixed << std::setprecision(3)
+                  << (seconds * 1000.0 / options.frames) << " ms/frame (level of detail " << glClock.getWallLod() << ")" << std::endl;
+    }
+
+    return 0;
+}
+
+// imports an .obj file with the native importer and with Assimp, CPU side only, and compares the times
+static int runObjImportBenchmark(const RunOptions &options){
+
+    const std::string &path = options.benchObj;
+    double nativeSeconds{0.0};
+    double assimpSeconds{0.0};
+    size_t nativeVertices{0}, nativeIndices{0}, assimpVertices{0}, assimpIndices{0};
+
+    // the first run of each only warms the page cache and the pool
+    for(int run = 0; run <= OBJ_BENCHMARK_RUNS; run++){
+        Uint64 start = SDL_GetPerformanceCounter();
+        ObjScene scene;
+        if(!loadObj(path, scene)){
+            return 1;
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+        if(run > 0){
+            nativeSeconds += (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+        }
+        nativeVertices = nativeIndices = 0;
+        for(const ObjMesh &mesh : scene.meshes){
+            nativeVertices += mesh.vertices.size();
+            nativeIndices += mesh.indices.size();
+        }
+
+        // what Model does with Assimp: import, then convert every mesh
+        start = SDL_GetPerformanceCounter();
+        Assimp::Importer importer;
+        const aiScene *imported = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+        if(!imported || imported->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !imported->mRootNode){
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            return 1;
+        }
+        std::vector<std::vector<Vertex>> vertices(imported->mNumMeshes);
+        std::vector<std::vector<unsigned int>> indices(imported->mNumMeshes);
+        for(unsigned int i = 0; i < imported->mNumMeshes; i++){
+            readAssimpGeometry(imported->mMeshes[i], vertices[i], indices[i]);
+        }
+        end = SDL_GetPerformanceCounter();
+        if(run > 0){
+            assimpSeconds += (double)(end - start) / (double)SDL_GetPerformanceFrequency();
+        }
+        assimpVertices = assimpIndices = 0;
+        for(unsigned int i = 0; i < imported->mNumMeshes; i++){
+            assimpVertices += vertices[i].size();
+            assimpIndices += indices[i].size();
+        }
+    }
+
+    double nativeMs = nativeSeconds * 1000.0 / OBJ_BENCHMARK_RUNS;
+    double assimpMs = assimpSeconds * 1000.0 / OBJ_BENCHMARK_RUNS;
+    std::cout << "OBJ import benchmark: " << path << ", " << OBJ_BENCHMARK_RUNS << " runs each" << std::endl;
+    std::cout << std::fixed << std::setprecision(3)
+              << "  native: " << std::setw(10) << nativeMs << " ms (" << nativeVertices << " vertices, " << nativeIndices << " indices)" << std::endl
+              << "  assimp: " << std::setw(10) << assimpMs << " ms (" << assimpVertices << " vertices, " << assimpIndices << " indices)" << std::endl
+              << "  speedup: " << std::setprecision(2) << (nativeMs > 0.0 ? assimpMs / nativeMs : 0.0) << "x" << std::endl;
+
+    return 0;
+}
+
 int main(int argc, char *argv[]){
 
+    TRACE_THREAD_NAME("main");
+
     //Useful variables
     int exitCode{0};
-    Uint64 NOW = SDL_GetPerformanceCounter();
-    Uint64 LAST = 0;
+
+    RunOptions options;
+    if(parseOptions(argc, argv, options) == false){
+        return 1;
+    }
+
+    // CPU only, no window or context needed
+    if(!options.benchObj.empty()){
+        return runObjImportBenchmark(options);
+    }
 
     glClockpp glClock;
 
-    //glfw: initialize and configure;
-    if(glClock.initializeSDL() == false){
-        SDL_Log("Unable to initialize program!\n");
-        exitCode = 1;
+    if(options.headless){
+        if(glClock.initializeHeadless(options.width, options.height) == false){
+            return 1;
+        }
+    } else {
+        //glfw: initialize and configure;
+        if(glClock.initializeSDL() == false){
+            SDL_Log("Unable to initialize program!\n");
+            exitCode = 1;
+        }
     }
 
     Camera &camera = glClock.getCamera();
     camera.Yaw = 0.0f;
 
+    glClock.setForcedLod(options.lod);
+
     SDL_Window *window = glClock.getWindow();
     
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)){
+    GLADloadproc loader = options.headless ? (GLADloadproc)HeadlessContext::getProcAddress : (GLADloadproc)SDL_GL_GetProcAddress;
+    bool gladLoaded;
+    {
+        TRACE_SCOPE("gladLoadGLLoader");
+        gladLoaded = gladLoadGLLoader(loader);
+    }
+    if (!gladLoaded){
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
 
+    if(options.headless){
+        if(glClock.getHeadless().createFramebuffer() == false){
+            return 1;
+        }
+        glClock.setViewportSize(options.width, options.height);
+    } else {
+        // the level of detail selection needs the real framebuffer height from the first frame on
+        glClock.handleWindowSizeChange();
+    }
+
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
-    glEnable(GL_CULL_FACE);
+    // every change of the tracked state goes through GLState, which drops the redundant ones
+    GLState &glState = GLState::instance();
+    glState.setEnabled(GL_DEPTH_TEST, true);
+    glState.setEnabled(GL_BLEND, true);
+    glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState.setEnabled(GL_CULL_FACE, true);
+
+    if(options.profile){
+        glClock.getProfiler().enable();
+    }
 
     // build and compile shaders
     // -------------------------
-    Shader modelShader("res/model_shader.vs", "res/model_shader.fs");
+    // the variants are compiled on first use, with the features the scene and each material need
+    ShaderVariants modelShaders("res/model_shader.vs", "res/model_shader.fs");
+    glClock.setupSceneUniforms();
 
     // load models
     // -----------
-    Model clockModel("res/3DClock.obj");
+    // imported concurrently on the pool, each model is uploaded and drawn as soon as it is ready
+    ModelLoader models;
+    ModelImporter importer = options.assimp ? ModelImporter::Assimp : ModelImporter::Auto;
+    Model &clockModel = models.load("res/3DClock.obj", false, true, importer, options.keepGeometry);
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    Model hourHand("res/Hours_hand.obj");
-    Model minutesHand("res/Minutes_hand.obj");
-    Model glassCover("res/glass.obj");
+    Model &hourHand = models.load("res/Hours_hand.obj", false, true, importer, options.keepGeometry);
+    Model &minutesHand = models.load("res/Minutes_hand.obj", false, true, importer, options.keepGeometry);
+    Model &glassCover = models.load("res/glass.obj", false, true, importer, options.keepGeometry);
+
+    if(options.clocks > 0){
+        glClock.setupClockWall(options.clocks, clockModel, hourHand, minutesHand, glassCover);
+    }
+
+    // measurements and frame dumps always cover the complete scene
+    if(options.benchClocks || options.headless){
+        models.finishAll();
+    }
+
+    if(options.benchClocks){
+        return runClockWallBenchmark(glClock, options, modelShaders, clockModel, hourHand, minutesHand, glassCover);
+    }
+
+    if(options.headless){
+        return runHeadless(glClock, options, modelShaders, clockModel, hourHand, minutesHand, glassCover);
+    }
 
     glClock.UpdateWindowTitle(window);
 
+    // idle mode only redraws once a minute, the hands jump with it instead of sweeping
+    glClock.setSmoothHands(!options.idle);
+
     bool quit{false};
+    std::string tracing = options.tracePath;
+    bool presented{false};
+    // in idle mode a frame is only rendered after waking up
+    bool redraw{true};
 
     SDL_Event *e = glClock.getEvent();
 
+    FrameProfiler &profiler = glClock.getProfiler();
+    const ProfilePhases &phases = glClock.getProfilePhases();
+
+    FramePacer &pacer = glClock.getPacer();
+    pacer.setTargetFps(options.fps);
+    SwapMode swapMode = pacer.setSwapMode(options.swapMode);
+    SDL_Log("Frame pacing: %s, target %.1f fps\n", FramePacer::swapModeName(swapMode), options.fps);
+
     // render loop
     // -----------
     while(quit == false){
 
-        while(SDL_PollEvent(e) == true){
-            
-            switch(e->type){
-
-                case SDL_EVENT_QUIT:
-                    quit = true;
-                    break;
-
-                case SDL_EVENT_KEY_DOWN:
-                    glClock.handleKeyboardEvent(*e);
-                    break;
-
-                case SDL_EVENT_MOUSE_BUTTON_DOWN:
-                case SDL_EVENT_MOUSE_BUTTON_UP:
-                    glClock.handleMouseEvent(window, *e);
-                    break;
-
-                case SDL_EVENT_MOUSE_MOTION:
-                    glClock.handleMouseMotionEvent(*e);
-                    break;
+        // idle mode: nothing changes on screen until an event arrives or the displayed minute
+        // ticks over, so block until one of them happens instead of spinning at full rate
+        if(options.idle && redraw == false){
+            if(SDL_WaitEventTimeout(e, glClock.getMillisecondsToNextMinute()) == true){
+                glClock.handleEvent(*e, quit);
+            }
+            // don't count the time spent asleep as frame time
+            pacer.resetTiming();
+        }
 
-                case SDL_EVENT_MOUSE_WHEEL:
-                    glClock.handleMouseScrollEvent(*e);
-                    break;                
+        profiler.beginFrame();
+        GLState::instance().beginFrame();
+        profiler.beginPhase(phases.events);
 
-                case SDL_EVENT_WINDOW_RESIZED:
-                    glClock.handleWindowSizeChange();
-                    break;
-            }
+        while(SDL_PollEvent(e) == true){
+            glClock.handleEvent(*e, quit);
         }
 
+        profiler.endPhase(phases.events);
+
         // per-frame time logic
         // --------------------
-        constexpr Uint64 nsPerFrame = 1000000000 / 60;
-        Uint64 frameNS{SDL_GetTicksNS()};
-        if(frameNS < nsPerFrame){
-            SDL_DelayNS(nsPerFrame - frameNS);
-        }
+        glClock.setDeltaTime(pacer.waitForNextFrame());
 
-        //Delta time
-        LAST = NOW;
-        NOW = SDL_GetPerformanceCounter();
-        glClock.setDeltaTime((double)((NOW - LAST)*1000 / (double)SDL_GetPerformanceFrequency()));
+        // upload the models whose import finished since the last frame, the others aren't drawn yet
+        bool loading = !models.finishReady();
 
         // render
         // ------
@@ -202,33 +574,54 @@ int main(int argc, char *argv[]){
         //glClearColor(1.0f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        glClock.drawGirodNormal(modelShader, clockModel, hourHand, minutesHand, glassCover);
+        if(options.clocks > 0){
+            glClock.drawClockWall(modelShaders, clockModel, hourHand, minutesHand, glassCover);
+        } else {
+            glClock.drawGirodNormal(modelShaders, clockModel, hourHand, minutesHand, glassCover);
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        SDL_GL_SwapWindow(window);
+        profiler.beginPhase(phases.swap);
+        {
+            TRACE_SCOPE("SDL_GL_SwapWindow");
+            SDL_GL_SwapWindow(window);
+        }
+        profiler.endPhase(phases.swap);
+
+        if(!presented){
+            TRACE_INSTANT("first presented frame");
+            presented = true;
+        }
+
+        // the startup trace ends with the first frame showing every model, so the imports and
+        // uploads still running on the pool after the first frame are part of it
+        if(!tracing.empty() && !loading){
+            Trace::write(tracing);
+            tracing.clear();
+        }
+
+        profiler.endFrame();
+        GLState::instance().endFrame();
+
+        // keep rendering until every model showed up, even in idle mode
+        redraw = !options.idle || loading;
     }
 
+    profiler.report(std::cout);
+    GLState::instance().report(std::cout);
+    pacer.report(std::cout);
+
     return exitCode;
 }
 
 //Clock drawing functions
 
-void glClockpp::drawGirodNormal(Shader &modelShader, Model &clockModel, Model &hoursHandModel, Model &minutesHandModel, Model &glassCoverModel, ...){
+void glClockpp::setupSceneUniforms(){
 
-    // don't forget to enable shader before setting uniforms
-    modelShader.use();
-    // Material settings
-    modelShader.setFloat("material.shininess", 32.0f);
-    modelShader.setVec3("viewPos", camera.Position);
-
-
-    auto *lTime = getLocalTime();
-    hours = lTime->tm_hour;
-    minutes = lTime->tm_min;
-
-    hourAngle = -((hours + minutes / 60.0f) * 30.0f);
-    minuteAngle = -(minutes * 6.0f);
+    sceneUniforms.init();
+    // only the point lights are set up, the directional and spot lights are compiled out
+    sceneFeatures = shaderPointLights(NR_POINT_LIGHTS);
 
     // positions of the point lights
     glm::vec3 pointLightPositions[] = {
@@ -237,57 +630,130 @@ void glClockpp::drawGirodNormal(Shader &modelShader, Model &clockModel, Model &h
     glm::vec3(0.0f, 0.1f, 0.2f)
     };
 
-    // point light 1
-        modelShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        modelShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        modelShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        modelShader.setFloat("pointLights[0].constant", 1.0f);
-        modelShader.setFloat("pointLights[0].linear", 0.09f);
-        modelShader.setFloat("pointLights[0].quadratic", 0.032f);
-        // point light 2
-        modelShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        modelShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        modelShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        modelShader.setFloat("pointLights[1].constant", 1.0f);
-        modelShader.setFloat("pointLights[1].linear", 0.09f);
-        modelShader.setFloat("pointLights[1].quadratic", 0.032f);
-        // point light 3
-        modelShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-        modelShader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-        modelShader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-        modelShader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-        modelShader.setFloat("pointLights[2].constant", 1.0f);
-        modelShader.setFloat("pointLights[2].linear", 0.09f);
-        modelShader.setFloat("pointLights[2].quadratic", 0.032f);
-        // spotLight...
-
-
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)window_Width / window_Height, 0.1f, 100.0f);
-        //glm::mat4 view = camera.GetViewMatrix();
+    // the lights are static: they are uploaded once, on the first frame
+    for(int i = 0; i < NR_POINT_LIGHTS; i++){
+        PointLightBlock light{};
+        light.position = pointLightPositions[i];
+        light.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+        light.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+        light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+        light.constant = 1.0f;
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+        sceneUniforms.setPointLight(i, light);
+    }
+}
+
+void glClockpp::updateSceneUniforms(){
+
+    // view/projection transformations, only rebuilt when the camera moved or the window was resized
+    if(camera.Dirty || projectionDirty){
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)window_Width / window_Height, NEAR_PLANE, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        modelShader.setMat4("projection", projection);
-        modelShader.setMat4("view", view);
+        sceneUniforms.setMatrices(projection, view, camera.Position);
+        camera.Dirty = false;
+        projectionDirty = false;
+    }
+
+    // one float drives every hand of every clock
+    sceneUniforms.setTimeOfDay(getTimeOfDay());
+
+    sceneUniforms.upload();
+}
+
+void glClockpp::drawGirodNormal(ShaderVariants &modelShaders, Model &clockModel, Model &hoursHandModel, Model &minutesHandModel, Model &glassCoverModel, ...){
+
+    profiler.beginPhase(phases.uniforms);
+
+    updateSceneUniforms();
+
+    profiler.endPhase(phases.uniforms);
 
         // render the loaded model
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	// it's a bit too big for our scene, so scale it down
-        modelShader.setMat4("model", model);
+        // Material settings, the hands are rotated by the vertex shader from the time of day
+        ObjectUniforms object{model, 32.0f, CLOCK_BODY};
+        // the clock sits at the origin
+        float distance = glm::length(camera.Position);
+
+        {
+            ProfileScope scope(profiler, phases.clockDraw);
+            clockModel.Draw(modelShaders, sceneFeatures, object, selectLod(clockModel, distance, 1.0f));
+        }
+
+        object.hand = CLOCK_HOUR_HAND;
+        {
+            ProfileScope scope(profiler, phases.hoursDraw);
+            hoursHandModel.Draw(modelShaders, sceneFeatures, object, selectLod(hoursHandModel, distance, 1.0f));
+        }
 
-        clockModel.Draw(modelShader);
+        object.hand = CLOCK_MINUTE_HAND;
+        {
+            ProfileScope scope(profiler, phases.minutesDraw);
+            minutesHandModel.Draw(modelShaders, sceneFeatures, object, selectLod(minutesHandModel, distance, 1.0f));
+        }
+
+        // the glass has always turned with the minute hand
+        {
+            ProfileScope scope(profiler, phases.glassDraw);
+            glassCoverModel.Draw(modelShaders, sceneFeatures, object, selectLod(glassCoverModel, distance, 1.0f));
+        }
+}
+
+void glClockpp::setupClockWall(size_t count, Model &clockModel, Model &hoursHandModel, Model &minutesHandModel, Model &glassCoverModel){
+
+    clockWall.layoutGrid(count, CLOCK_SIZE);
+
+    clockModel.attachInstances(clockWall);
+    hoursHandModel.attachInstances(clockWall);
+    minutesHandModel.attachInstances(clockWall);
+    glassCoverModel.attachInstances(clockWall);
+}
+
+void glClockpp::drawClockWall(ShaderVariants &modelShaders, Model &clockModel, Model &hoursHandModel, Model &minutesHandModel, Model &glassCoverModel){
+
+    profiler.beginPhase(phases.uniforms);
+
+    updateSceneUniforms();
+
+    profiler.endPhase(phases.uniforms);
+
+    // each part is drawn once for the whole wall, at the level of detail the nearest clock needs
+    float distance = clockWall.nearestDistance(camera.Position);
+    float scale = clockWall.getClockScale();
+    wallLod = selectLod(clockModel, distance, scale);
+    {
+        ProfileScope scope(profiler, phases.clockDraw);
+        clockModel.DrawInstanced(modelShaders, sceneFeatures, CLOCK_BODY, 32.0f, clockWall.size(), wallLod);
+    }
+    {
+        ProfileScope scope(profiler, phases.hoursDraw);
+        hoursHandModel.DrawInstanced(modelShaders, sceneFeatures, CLOCK_HOUR_HAND, 32.0f, clockWall.size(), selectLod(hoursHandModel, distance, scale));
+    }
+    {
+        ProfileScope scope(profiler, phases.minutesDraw);
+        minutesHandModel.DrawInstanced(modelShaders, sceneFeatures, CLOCK_MINUTE_HAND, 32.0f, clockWall.size(), selectLod(minutesHandModel, distance, scale));
+    }
+    {
+        ProfileScope scope(profiler, phases.glassDraw);
+        glassCoverModel.DrawInstanced(modelShaders, sceneFeatures, CLOCK_BODY, 32.0f, clockWall.size(), selectLod(glassCoverModel, distance, scale));
+    }
+}
 
-        glm::mat4 hourModel = glm::rotate(glm::mat4(1.0f), glm::radians(hourAngle), glm::vec3(0.0f, 0.0f, 1.0f));
-        modelShader.setMat4("model", hourModel);
-        hoursHandModel.Draw(modelShader);
+size_t glClockpp::selectLod(const Model &model, float distance, float scale) const{
 
-        glm::mat4 minuteModel = glm::rotate(glm::mat4(1.0f), glm::radians(minuteAngle), glm::vec3(0.0f, 0.0f, 1.0f));
-        modelShader.setMat4("model", minuteModel);
-        minutesHandModel.Draw(modelShader);
+    if(forcedLod >= 0){
+        return static_cast<size_t>(forcedLod);
+    }
 
-        glassCoverModel.Draw(modelShader);
+    // the closest the model gets, whichever way the hands turn it about the origin
+    float reach = (glm::length(model.getBoundsCenter()) + model.getBoundsRadius()) * scale;
+    float nearest = std::max(distance - reach, NEAR_PLANE);
+    // screen pixels covered by one model unit at that distance, from the vertical field of view
+    float pixelsPerUnit = window_Height * 0.5f / std::tan(glm::radians(camera.Zoom) * 0.5f) / nearest * scale;
+    return model.selectLod(pixelsPerUnit);
 }
 
 //Misc functions
@@ -300,6 +766,23 @@ std::tm *glClockpp::getLocalTime(){
     return localtime;
 }
 
+float glClockpp::getTimeOfDay(){
+
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    std::tm *localtime = std::localtime(&seconds);
+
+    hours = localtime->tm_hour;
+    minutes = localtime->tm_min;
+
+    float timeOfDay = static_cast<float>(hours * 3600 + minutes * 60);
+    if(smoothHands){
+        double fraction = std::chrono::duration<double>(now - std::chrono::system_clock::from_time_t(seconds)).count();
+        timeOfDay += static_cast<float>(localtime->tm_sec + fraction);
+    }
+    return timeOfDay;
+}
+
 void glClockpp::UpdateWindowTitle(SDL_Window *window){
     
     auxinfo.clear();
@@ -319,8 +802,49 @@ void glClockpp::UpdateWindowTitle(SDL_Window *window){
     SDL_SetWindowTitle(window, title.c_str());
 }
 
+int glClockpp::getMillisecondsToNextMinute() const{
+
+    // time zones are offset by whole minutes, so local minutes tick over together with UTC ones
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    long long msIntoMinute = std::chrono::duration_cast<std::chrono::milliseconds>(now).count() % 60000;
+
+    // wake slightly after the boundary so localtime() already reports the new minute
+    return static_cast<int>(60000 - msIntoMinute) + 5;
+}
+
 //Handlers
 
+void glClockpp::handleEvent(SDL_Event &e, bool &quit){
+
+    switch(e.type){
+
+        case SDL_EVENT_QUIT:
+            quit = true;
+            break;
+
+        case SDL_EVENT_KEY_DOWN:
+            handleKeyboardEvent(e);
+            break;
+
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            handleMouseEvent(gWindow, e);
+            break;
+
+        case SDL_EVENT_MOUSE_MOTION:
+            handleMouseMotionEvent(e);
+            break;
+
+        case SDL_EVENT_MOUSE_WHEEL:
+            handleMouseScrollEvent(e);
+            break;                
+
+        case SDL_EVENT_WINDOW_RESIZED:
+            handleWindowSizeChange();
+            break;
+    }
+}
+
 void glClockpp::handleKeyboardEvent(SDL_Event &e){
 
     SDL_Event quit_event;
@@ -336,21 +860,27 @@ void glClockpp::handleKeyboardEvent(SDL_Event &e){
         case SDLK_ESCAPE:
             SDL_PushEvent(&quit_event);
             break;
+
+        case SDLK_F3:
+            profiler.report(std::cout);
+            pacer.report(std::cout);
+            GLState::instance().report(std::cout);
+            break;
         
         case SDLK_W:
-            camera.ProcessKeyboard(FORWARD, dTime/10);
+            camera.ProcessKeyboard(FORWARD, dTime);
             break;
         
         case SDLK_S:
-            camera.ProcessKeyboard(BACKWARD, dTime/10);
+            camera.ProcessKeyboard(BACKWARD, dTime);
             break;
 
         case SDLK_A:
-            camera.ProcessKeyboard(LEFT, dTime/10);
+            camera.ProcessKeyboard(LEFT, dTime);
             break;
 
         case SDLK_D:
-            camera.ProcessKeyboard(RIGHT, dTime/10);
+            camera.ProcessKeyboard(RIGHT, dTime);
             break;
 
         default:
@@ -394,8 +924,19 @@ void glClockpp::handleMouseScrollEvent(SDL_Event &e){
 
 void glClockpp::handleWindowSizeChange(){
 
-    SDL_GetWindowSizeInPixels(gWindow, &window_Width, &window_Height);
+    int width, height;
+    SDL_GetWindowSizeInPixels(gWindow, &width, &height);
+
+    setViewportSize(width, height);
+
+}
+
+void glClockpp::setViewportSize(int width, int height){
+
+    window_Width = width;
+    window_Height = height;
 
     glViewport(0, 0, window_Width, window_Height);
+    projectionDirty = true;
 
 }
\ No newline at end of file
@@ -13,37 +13,131 @@
 #include <SDL3/SDL.h>
 #include <assimp/light.h>
 #include "Shader.hpp"
+#include "ShaderVariants.hpp"
+#include "Headless.hpp"
+#include "FrameProfiler.hpp"
+#include "FramePacer.hpp"
+#include "UniformBuffers.hpp"
+#include "ClockInstances.hpp"
+#include "GLState.hpp"
+#include "ModelLoader.hpp"
+#include "Trace.hpp"
+#include "AllocationCounter.hpp"
 #include "stb_image.h"
 
 //window settings
 constexpr unsigned int SCREEN_WIDTH{640};
 constexpr unsigned int SCREEN_HEIGHT{480};
 
+// width of the clock model, the pitch of the clock wall grid
+constexpr float CLOCK_SIZE{0.1f};
+
+// distance of the near clipping plane
+constexpr float NEAR_PLANE{0.1f};
+
+// command line options
+struct RunOptions{
+    // render offscreen through EGL instead of opening a window
+    bool headless{false};
+    int width{SCREEN_WIDTH};
+    int height{SCREEN_HEIGHT};
+    // number of frames rendered in headless mode
+    int frames{300};
+    // directory where headless frames are written as PPM images, empty to disable
+    std::string dumpDir;
+    // collect per-phase CPU/GPU timings, reported on exit (or with F3)
+    bool profile{false};
+    // only render when an event arrives or the displayed minute changes
+    bool idle{false};
+    // software frame rate limit, 0 for none
+    double fps{60.0};
+    SwapMode swapMode{SwapMode::VSync};
+    // draw a wall of this many instanced clocks instead of the single clock, 0 to disable
+    int clocks{0};
+    // time the instanced wall at 1, 100, 1000 and 10000 clocks, then exit
+    bool benchClocks{false};
+    // fail the headless run if a steady-state frame allocates heap memory
+    bool checkAllocs{false};
+    // Chrome trace-event JSON of the startup, written after the first frame, empty to disable
+    std::string tracePath;
+    // read the .obj models with Assimp instead of the native importer
+    bool assimp{false};
+    // .obj file whose import time is compared between the native importer and Assimp, then exit
+    std::string benchObj;
+    // level of detail every model is drawn with, -1 to pick it from the screen-space size
+    int lod{-1};
+    // keep the CPU-side vertices and indices of the models after upload, nothing reads them by default
+    bool keepGeometry{false};
+};
+
+// headless frames rendered before --check-allocs starts counting: the shader variants are compiled
+// and the driver fills its caches during the first draws
+constexpr int ALLOCATION_CHECK_WARMUP{3};
+
+// timed imports of each importer in the --bench-obj comparison, after an untimed one
+constexpr int OBJ_BENCHMARK_RUNS{10};
+
+// ids of the phases timed by the frame profiler
+struct ProfilePhases{
+    int events;
+    int uniforms;
+    int clockDraw;
+    int hoursDraw;
+    int minutesDraw;
+    int glassDraw;
+    int swap;
+};
+
+bool parseOptions(int argc, char *argv[], RunOptions &options);
+
 class glClockpp{
     public:
         
         glClockpp();
         ~glClockpp();
 
-        void drawGirodNormal(Shader &modelShader, Model &clockModel, Model &hourModel, Model &minuteModel, Model &glassCoverModel, ...);
+        void setupSceneUniforms();
+        void updateSceneUniforms();
+
+        void drawGirodNormal(ShaderVariants &modelShaders, Model &clockModel, Model &hourModel, Model &minuteModel, Model &glassCoverModel, ...);
+
+        // instanced clock wall
+        void setupClockWall(size_t count, Model &clockModel, Model &hourModel, Model &minuteModel, Model &glassCoverModel);
+        void drawClockWall(ShaderVariants &modelShaders, Model &clockModel, Model &hourModel, Model &minuteModel, Model &glassCoverModel);
+
+        // level of detail of a model drawn at the given scale, `distance` away from the camera
+        size_t selectLod(const Model &model, float distance, float scale) const;
 
         std::tm *getLocalTime();
+        // local time in seconds since midnight, whole minutes unless the hands sweep
+        float getTimeOfDay();
+        int getMillisecondsToNextMinute() const;
 
         bool initializeSDL();
+        bool initializeHeadless(int width, int height);
 
         //Handlers
+        void handleEvent(SDL_Event &event, bool &quit);
         void handleKeyboardEvent(SDL_Event &event);
         void handleMouseEvent(SDL_Window *window, SDL_Event &event);
         void handleMouseMotionEvent(SDL_Event &event);
         void handleMouseScrollEvent(SDL_Event &event);
         void handleWindowSizeChange();
+        void setViewportSize(int width, int height);
         
         //Getters and setters
         Camera &getCamera(){return camera;}
         SDL_Window *getWindow(){return gWindow;}
+        HeadlessContext &getHeadless(){return headless;}
+        FrameProfiler &getProfiler(){return profiler;}
+        FramePacer &getPacer(){return pacer;}
+        const ProfilePhases &getProfilePhases() const {return phases;}
         SDL_Event *getEvent(){return &event;}
         float getDeltaTime() const {return deltaTime;}
         void setDeltaTime(float dTime){deltaTime = dTime;}
+        void setSmoothHands(bool smooth){smoothHands = smooth;}
+        void setForcedLod(int lod){forcedLod = lod;}
+        size_t getWallLod() const {return wallLod;}
         bool getMouseRotating() const {return rotating;}
         void setMouseRotating(bool rMouse){rotating = rMouse;}
         float getWindowWidth() const {return window_Width;}
@@ -60,15 +154,36 @@ class glClockpp{
         bool firstMouse;
         bool rotating;
 
-        //timing
+        //timing, in seconds
         float deltaTime;
         float lastFrame;
 
         //Time variables
         int hours;
         int minutes;
-        float hourAngle;
-        float minuteAngle;
+        // hands move continuously instead of once a minute
+        bool smoothHands;
+
+        //Offscreen context, only used in headless mode
+        HeadlessContext headless;
+
+        //Instrumentation
+        FrameProfiler profiler;
+        ProfilePhases phases;
+        FramePacer pacer;
+
+        //Shader uniforms
+        UniformBuffers sceneUniforms;
+        ClockInstances clockWall;
+        // lighting features of the scene, selecting the model shader variants
+        uint32_t sceneFeatures;
+        bool projectionDirty;
+
+        //Levels of detail
+        // level every model is drawn with, -1 when chosen by screen-space size
+        int forcedLod;
+        // level the clock bodies of the wall were last drawn with
+        size_t wallLod;
 
         //Window and title info
         int window_Width;
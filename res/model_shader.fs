@@ -1,6 +1,15 @@
 #version 330 core
 out vec4 FragColor;
 
+// Feature switches, defined per variant by ShaderVariants (see ShaderVariants.hpp):
+//   NR_POINT_LIGHTS  point lights in the Lights block, may be 0
+//   DIR_LIGHT        directional light
+//   SPOT_LIGHT       spot light
+//   SPECULAR_MAP     the material has a specular texture, otherwise the diffuse color is reused
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 3
+#endif
+
 struct Material {
     sampler2D diffuse;
     sampler2D specular;
@@ -14,15 +23,14 @@ struct DirLight {
     vec3 specular;
 };
 
+// std140 layout: each float fills the padding after the preceding vec3 (see UniformBuffers.hpp)
 struct PointLight {
     vec3 position;
-
     float constant;
-    float linear;
-    float quadratic;
-
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 
@@ -41,24 +49,49 @@ struct SpotLight {
     vec3 specular;
 };
 
-#define NR_POINT_LIGHTS 3
+layout (std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
+#if NR_POINT_LIGHTS > 0
+layout (std140) uniform Lights {
+    PointLight pointLights[NR_POINT_LIGHTS];
+};
+#endif
+
+#ifdef DIR_LIGHT
 uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+#endif
+#ifdef SPOT_LIGHT
 uniform SpotLight spotLight;
-uniform vec3 viewPos;
+#endif
 uniform Material material;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specColor);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specColor);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specColor);
 
 void main()
 {
+    // leer textura diffuse con alpha, una sola vez para todas las luces
+    vec4 texColor = texture(material.diffuse, TexCoords);
+
+    // descartar fragmentos totalmente transparentes
+    if (texColor.a < 0.1)
+        discard;
+
+#ifdef SPECULAR_MAP
+    vec3 specColor = vec3(texture(material.specular, TexCoords));
+#else
+    vec3 specColor = texColor.rgb;
+#endif
+
     // properties
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
@@ -67,29 +100,29 @@ void main()
     // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
     // For each phase, a calculate function is defined that calculates the corresponding color
     // per lamp. In the main() function we take all the calculated colors and sum them up for
-    // this fragment's final color.
+    // this fragment's final color. Phases the variant wasn't compiled with are left out.
     // == =====================================================
+    vec3 result = vec3(0.0);
     // phase 1: directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+#ifdef DIR_LIGHT
+    result += CalcDirLight(dirLight, norm, viewDir, texColor.rgb, specColor);
+#endif
     // phase 2: point lights
+#if NR_POINT_LIGHTS > 0
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);    
+        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, texColor.rgb, specColor);
+#endif
     // phase 3: spot light
-    //result += CalcSpotLight(spotLight, norm, FragPos, viewDir);    
-    
-    // leer textura diffuse con alpha
-    vec4 texColor = texture(material.diffuse, TexCoords);
-
-    // descartar fragmentos totalmente transparentes
-    if (texColor.a < 0.1)
-        discard;
+#ifdef SPOT_LIGHT
+    result += CalcSpotLight(spotLight, norm, FragPos, viewDir, texColor.rgb, specColor);
+#endif
 
     // aplicar iluminación * color de textura, conservando alpha
     FragColor = vec4(result * texColor.rgb, texColor.a);
 }
 
 // calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specColor)
 {
     vec3 lightDir = normalize(-light.direction);
     // diffuse shading
@@ -98,14 +131,14 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specColor;
     return (ambient + diffuse + specular);
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specColor)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
@@ -117,9 +150,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specColor;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -127,7 +160,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 }
 
 // calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specColor)
 {
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
@@ -143,9 +176,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    vec3 ambient = light.ambient * albedo;
+    vec3 diffuse = light.diffuse * diff * albedo;
+    vec3 specular = light.specular * spec * specColor;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
@@ -7,15 +7,61 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+layout (std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+// updated every frame, apart from the matrices
+layout (std140) uniform Frame {
+    // local time of day in seconds, drives the hands
+    float timeOfDay;
+};
+
+// part of the clock being drawn: 0 body, 1 hour hand, 2 minute hand
+uniform int hand;
+
+#ifdef INSTANCED
+// one clock of a wall, see ClockInstances.hpp
+layout (location = 8) in mat4 aInstanceTransform;
+// x = time zone offset in hours
+layout (location = 12) in vec4 aInstanceClock;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+mat4 rotateZ(float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    return mat4(c, s, 0.0, 0.0,
+                -s, c, 0.0, 0.0,
+                0.0, 0.0, 1.0, 0.0,
+                0.0, 0.0, 0.0, 1.0);
+}
+
+// rotation of the part being drawn at a local time of day, continuous so the hands sweep
+float handAngle(float seconds)
+{
+    if (hand == 1)
+        return -radians(mod(seconds / 3600.0, 12.0) * 30.0);
+    if (hand == 2)
+        return -radians(mod(seconds / 60.0, 60.0) * 6.0);
+    return 0.0;
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+#ifdef INSTANCED
+    mat4 world = aInstanceTransform * rotateZ(handAngle(timeOfDay + aInstanceClock.x * 3600.0));
+#else
+    mat4 world = model * rotateZ(handAngle(timeOfDay));
+#endif
+
+    FragPos = vec3(world * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(world))) * aNormal;  
     TexCoords = aTexCoords;
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * world * vec4(aPos, 1.0);
 }
\ No newline at end of file